@@ -32,13 +32,6 @@
 // Structures
 // ------------------------------------------------------------------------
 
-// Structure that defines a vector using x and y
-typedef struct {
-	GLfloat x;
-	GLfloat y;
-	GLfloat z;
-} Vector3f;
-
 // Structure that holds the location and size for each point sprite
 typedef struct 
 {
@@ -66,16 +59,18 @@ typedef struct
 	GLfloat		particleSize;
 	GLfloat		particleSizeDelta;
 	GLfloat		timeToLive;
+	Vector3f	previousPosition;	// State before the last fixed step, for interpolation
+	GLfloat		previousSize;
 } Particle3D;
 
 // ------------------------------------------------------------------------
 // Inline functions
 // ------------------------------------------------------------------------
 
-// Return a zero populated Vector2f
+// Return a zero populated Vector3f
 static const Vector3f Vector3fZero = {0.0f, 0.0f, 0.0f};
 
-// Return a populated Vector2d structure from the floats passed in
+// Return a populated Vector3f structure from the floats passed in
 static inline Vector3f Vector3fMake(GLfloat x, GLfloat y, GLfloat z) {
 	Vector3f r; r.x = x; r.y = y; r.z = z;
 	return r;
@@ -118,70 +113,50 @@ static inline GLfloat Vector3fLength(Vector3f v) {
 	return (GLfloat) sqrtf(Vector3fDot(v, v));
 }
 
-// Return a Vector2f containing a normalized vector v
+// Return a Vector3f containing a normalized vector v
 static inline Vector3f Vector3fNormalize(Vector3f v) {
 	return Vector3fMultiply(v, 1.0f/Vector3fLength(v));
 }
 
 // ------------------------------------------------------------------------
-// ofx3DParticleEmitter
+// Dimensions
 // ------------------------------------------------------------------------
 
-class ofx3DParticleEmitter: public ofxParticleEmitter
+// See ParticleDimension<2> in ofxParticleEmitter.h
+template <>
+struct ParticleDimension<3>
 {
+	typedef Vector3f		Vector;
+	typedef Particle3D		Particle;
+	typedef PointSprite3D	PointSprite;
 	
-public:
-	
-	ofx3DParticleEmitter();
-	~ofx3DParticleEmitter();
+	enum { features = kParticleFeatureDepth };
 	
-	bool	loadFromXml( const std::string& filename );
-	void	update();
-    void    draw(int x, int y);
-    
-	int				emitterType;
-	Vector3f		sourcePosition, sourcePositionVariance;			
-	GLfloat			angle, angleVariance;								
-	GLfloat			speed, speedVariance;	
-	GLfloat			radialAcceleration, tangentialAcceleration;
-	GLfloat			radialAccelVariance, tangentialAccelVariance;
-	Vector3f		gravity;	
-	GLfloat			particleLifespan, particleLifespanVariance;			
-	Color4f			startColor, startColorVariance;						
-	Color4f			finishColor, finishColorVariance;
-	GLfloat			startParticleSize, startParticleSizeVariance;
-	GLfloat			finishParticleSize, finishParticleSizeVariance;
-	GLint			maxParticles;
-	GLint			particleCount;
-	GLfloat			duration;
-	int				blendFuncSource, blendFuncDestination;
-
-	// Particle ivars only used when a maxRadius value is provided.  These values are used for
-	// the special purpose of creating the spinning portal emitter
-	GLfloat			maxRadius;						// Max radius at which particles are drawn when rotating
-	GLfloat			maxRadiusVariance;				// Variance of the maxRadius
-	GLfloat			radiusSpeed;					// The speed at which a particle moves from maxRadius to minRadius
-	GLfloat			minRadius;						// Radius from source below which a particle dies
-	GLfloat			rotatePerSecond;				// Number of degrees to rotate a particle around the source position per second
-	GLfloat			rotatePerSecondVariance;		// Variance in degrees for rotatePerSecond
+	static inline Vector	zero()									{ return Vector3fZero; }
+	static inline Vector	make( GLfloat x, GLfloat y, GLfloat z )	{ return Vector3fMake( x, y, z ); }
+	static inline GLfloat	getZ( const Vector& v )					{ return v.z; }
+	static inline GLfloat	getZ( const PointSprite& s )			{ return s.z; }
+	static inline void		setZ( Vector& v, GLfloat z )			{ v.z = z; }
+	static inline void		setZ( PointSprite& s, GLfloat z )		{ s.z = z; }
+	static inline bool		isZero( const Vector& v )				{ return !v.x && !v.y && !v.z; }
+	static inline Vector	add( Vector v1, Vector v2 )				{ return Vector3fAdd( v1, v2 ); }
+	static inline Vector	sub( Vector v1, Vector v2 )				{ return Vector3fSub( v1, v2 ); }
+	static inline Vector	multiply( Vector v, GLfloat s )			{ return Vector3fMultiply( v, s ); }
+	static inline Vector	normalize( Vector v )					{ return Vector3fNormalize( v ); }
 	
+	// v rotated by 90 degrees about the z axis
+	static inline Vector	perpendicular( Vector v )				{ return Vector3fMake( -v.y, v.x, 0.0f ); }
+};
+
+// ------------------------------------------------------------------------
+// ofx3DParticleEmitter
+// ------------------------------------------------------------------------
 
-protected:
+// The 3D emitter, the same engine as ofxParticleEmitter with z added, see ParticleEmitter
+typedef ParticleEmitter<3> ofx3DParticleEmitter;
 
-    void    exit();
-	void	init();
-	
-	void	parseParticleConfig();
-	void	setupArrays();
-	
-	bool	addParticle();
-	void	initParticle( Particle3D* particle );
-	
-	void	drawTextures();
-	
-	GLuint			verticesID;		// Holds the buffer name of the VBO that stores the color and vertices info for the particles
-	Particle3D*		particles;		// Array of particles that hold the particle emitters particle details
-	PointSprite3D*	vertices;		// Array of vertices and color information for each particle to be rendered
-};
+// Sprites at different depths cannot share the 2D quad batch
+template <> void ParticleEmitter<3>::drawTextures();
+template <> void ParticleEmitter<3>::appendQuads( ofxParticleQuadBatch& batch, int x, int y );
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,250 @@
+//
+// ofxParticleAtlas.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "ofxParticleAtlas.h"
+#include <algorithm>
+
+// Orders slot indices from the tallest sprite to the shortest
+class SlotTaller
+{
+	
+public:
+	
+	SlotTaller( const std::vector<ParticleAtlasSlot>& slots ) : slots( slots ) {}
+	
+	bool operator()( int a, int b ) const
+	{
+		return slots[a].height > slots[b].height;
+	}
+	
+protected:
+	
+	const std::vector<ParticleAtlasSlot>& slots;
+};
+
+// ------------------------------------------------------------------------
+// Lifecycle
+// ------------------------------------------------------------------------
+
+ofxParticleAtlas::ofxParticleAtlas( int pageSize, int padding ) : pageSize( pageSize ), padding( padding )
+{
+}
+
+ofxParticleAtlas::~ofxParticleAtlas()
+{
+	clear();
+}
+
+void ofxParticleAtlas::clear()
+{
+	for ( size_t i = 0; i < pages.size(); i++ )
+	{
+		pages[i]->clear();
+		delete pages[i];
+	}
+	
+	pages.clear();
+	images.clear();
+	slots.clear();
+}
+
+void ofxParticleAtlas::add( ofImage* image )
+{
+	if ( image == NULL || std::find( images.begin(), images.end(), image ) != images.end() )
+		return;
+	
+	ParticleAtlasSlot slot;
+	slot.width = image->width;
+	slot.height = image->height;
+	slot.x = slot.y = 0;
+	slot.page = -1;
+	
+	images.push_back( image );
+	slots.push_back( slot );
+}
+
+int ofxParticleAtlas::getPageCount() const
+{
+	return (int)pages.size();
+}
+
+// ------------------------------------------------------------------------
+// Packing
+// ------------------------------------------------------------------------
+
+int ofxParticleAtlas::pack( std::vector<ParticleAtlasSlot>& slots, int pageSize, int padding )
+{
+	std::vector<int> order( slots.size() );
+	for ( size_t i = 0; i < order.size(); i++ )
+		order[i] = (int)i;
+	std::stable_sort( order.begin(), order.end(), SlotTaller( slots ) );
+	
+	// Each page is filled with shelves from the top down.  A shelf is as tall as the first,
+	// and so tallest, sprite placed on it and sprites go left to right along it
+	int pageCount = 0;
+	int shelfX = 0, shelfY = 0, shelfHeight = 0;
+	
+	for ( size_t i = 0; i < order.size(); i++ )
+	{
+		ParticleAtlasSlot& slot = slots[order[i]];
+		int w = slot.width + padding * 2;
+		int h = slot.height + padding * 2;
+		
+		if ( w > pageSize || h > pageSize || slot.width <= 0 || slot.height <= 0 )
+		{
+			slot.page = -1;
+			continue;
+		}
+		
+		if ( pageCount == 0 )
+		{
+			pageCount = 1;
+			shelfX = shelfY = shelfHeight = 0;
+		}
+		
+		// Start a new shelf when the sprite does not fit on the end of this one
+		if ( shelfX + w > pageSize )
+		{
+			shelfY += shelfHeight;
+			shelfX = shelfHeight = 0;
+		}
+		
+		// And a new page when the new shelf does not fit
+		if ( shelfY + h > pageSize )
+		{
+			pageCount++;
+			shelfX = shelfY = shelfHeight = 0;
+		}
+		
+		slot.page = pageCount - 1;
+		slot.x = shelfX + padding;
+		slot.y = shelfY + padding;
+		
+		shelfX += w;
+		shelfHeight = MAX( shelfHeight, h );
+	}
+	
+	return pageCount;
+}
+
+void ofxParticleAtlas::copySprite( unsigned char* page, ofImage* image, const ParticleAtlasSlot& slot )
+{
+	const unsigned char* pixels = image->getPixels();
+	if ( pixels == NULL )
+		return;
+	
+	int channels = image->bpp / 8;
+	
+	// Fill the sprite and its padding, clamping to the sprite's edge so the padding repeats it
+	for ( int y = -padding; y < slot.height + padding; y++ )
+	{
+		int sy = MIN( MAX( y, 0 ), slot.height - 1 );
+		unsigned char* out = page + ( ( slot.y + y ) * pageSize + slot.x - padding ) * 4;
+		
+		for ( int x = -padding; x < slot.width + padding; x++, out += 4 )
+		{
+			int sx = MIN( MAX( x, 0 ), slot.width - 1 );
+			const unsigned char* in = pixels + ( sy * slot.width + sx ) * channels;
+			
+			// Grayscale images expand the way GL_LUMINANCE textures do
+			if ( channels >= 3 )
+			{
+				out[0] = in[0];
+				out[1] = in[1];
+				out[2] = in[2];
+			}
+			else
+			{
+				out[0] = out[1] = out[2] = in[0];
+			}
+			out[3] = channels == 4 ? in[3] : 255;
+		}
+	}
+}
+
+bool ofxParticleAtlas::build()
+{
+	for ( size_t i = 0; i < pages.size(); i++ )
+	{
+		pages[i]->clear();
+		delete pages[i];
+	}
+	pages.clear();
+	
+	int pageCount = pack( slots, pageSize, padding );
+	
+	std::vector<unsigned char> pixels( pageSize * pageSize * 4 );
+	
+	for ( int p = 0; p < pageCount; p++ )
+	{
+		std::fill( pixels.begin(), pixels.end(), 0 );
+		
+		for ( size_t i = 0; i < slots.size(); i++ )
+		{
+			if ( slots[i].page == p )
+				copySprite( &pixels[0], images[i], slots[i] );
+		}
+		
+		ofTexture* page = new ofTexture();
+		page->allocate( pageSize, pageSize, GL_RGBA );
+		page->loadData( &pixels[0], pageSize, pageSize, GL_RGBA );
+		pages.push_back( page );
+	}
+	
+	for ( size_t i = 0; i < slots.size(); i++ )
+	{
+		if ( slots[i].page < 0 )
+			ofLog( OF_LOG_WARNING, "ofxParticleAtlas::build() - sprite too large for an atlas page, it will be drawn on its own" );
+	}
+	
+	return pageCount > 0;
+}
+
+bool ofxParticleAtlas::getRegion( ofImage* image, ofTextureData& texData, ParticleTexRect& rect ) const
+{
+	for ( size_t i = 0; i < images.size(); i++ )
+	{
+		if ( images[i] != image )
+			continue;
+		
+		const ParticleAtlasSlot& slot = slots[i];
+		if ( slot.page < 0 || slot.page >= (int)pages.size() )
+			return false;
+		
+		texData = pages[slot.page]->getTextureData();
+		
+		// tex_t and tex_u span the whole page, in pixels for rectangle textures
+		GLfloat scaleU = texData.tex_t / pageSize;
+		GLfloat scaleV = texData.tex_u / pageSize;
+		
+		rect.u0 = slot.x * scaleU;
+		rect.v0 = slot.y * scaleV;
+		rect.u1 = ( slot.x + slot.width ) * scaleU;
+		rect.v1 = ( slot.y + slot.height ) * scaleV;
+		
+		return true;
+	}
+	
+	return false;
+}
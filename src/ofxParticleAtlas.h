@@ -0,0 +1,93 @@
+//
+// ofxParticleAtlas.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef _OFX_PARTICLE_ATLAS
+#define _OFX_PARTICLE_ATLAS
+
+#include "ofMain.h"
+#include "ofxParticleQuadBatch.h"
+
+#define PARTICLE_ATLAS_PAGE_SIZE	1024	// Default width and height of each page in pixels
+#define PARTICLE_ATLAS_PADDING		2		// Pixels of repeated edge around each sprite, so filtering never reads a neighbour
+
+// ------------------------------------------------------------------------
+// Structures
+// ------------------------------------------------------------------------
+
+// Placement of one sprite within the atlas, in pixels
+typedef struct
+{
+	int		width, height;		// Size of the sprite, set before packing
+	int		x, y;				// Top left of the sprite itself, inside its padding
+	int		page;				// Page the sprite was placed on, -1 if it does not fit on a page
+} ParticleAtlasSlot;
+
+// ------------------------------------------------------------------------
+// ofxParticleAtlas
+// ------------------------------------------------------------------------
+
+// Packs the sprites of many emitters into a few shared texture pages, so emitters with
+// different sprites can be drawn from one texture.  Sprites are placed on shelves, tallest
+// first, which wastes little space for the small, similarly sized images particles use
+class ofxParticleAtlas
+{
+	
+public:
+	
+	ofxParticleAtlas( int pageSize = PARTICLE_ATLAS_PAGE_SIZE, int padding = PARTICLE_ATLAS_PADDING );
+	~ofxParticleAtlas();
+	
+	// Queue an image to be packed by the next build().  Adding the same image twice is harmless
+	void	add( ofImage* image );
+	
+	// Pack every queued image and upload the pages.  Needs a GL context
+	bool	build();
+	
+	// Texture and coordinates of an image after build(), false if it is not in the atlas
+	bool	getRegion( ofImage* image, ofTextureData& texData, ParticleTexRect& rect ) const;
+	
+	int		getPageCount() const;
+	void	clear();
+	
+	// Place every slot on as few pages as possible and return how many pages are used.  Does
+	// not touch GL, so packing can be checked on its own
+	static int	pack( std::vector<ParticleAtlasSlot>& slots, int pageSize, int padding );
+	
+protected:
+	
+	void	copySprite( unsigned char* page, ofImage* image, const ParticleAtlasSlot& slot );
+	
+	int								pageSize;
+	int								padding;
+	std::vector<ofImage*>			images;
+	std::vector<ParticleAtlasSlot>	slots;		// One for each image
+	std::vector<ofTexture*>			pages;
+	
+private:
+	
+	ofxParticleAtlas( const ofxParticleAtlas& );
+	ofxParticleAtlas& operator=( const ofxParticleAtlas& );
+};
+
+#endif
@@ -0,0 +1,264 @@
+//
+// ofxParticleBinaryConfig.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "ofxParticleBinaryConfig.h"
+#include <fstream>
+#include <stdio.h>
+
+// Fail to compile if the record picks up padding or changes size by accident
+typedef char ParticleBinaryRecordSizeCheck[sizeof( ParticleBinaryRecord ) == 45 * 4 ? 1 : -1];
+
+// ------------------------------------------------------------------------
+// Format
+// ------------------------------------------------------------------------
+
+bool ofxParticleBinaryConfig::isBinary( const std::string& path )
+{
+	FILE* file = fopen( path.c_str(), "rb" );
+	if ( file == NULL )
+		return false;
+	
+	char magic[4];
+	bool binary = fread( magic, 1, 4, file ) == 4 && memcmp( magic, PARTICLE_BINARY_MAGIC, 4 ) == 0;
+	fclose( file );
+	
+	return binary;
+}
+
+std::string ofxParticleBinaryConfig::getCompiledName( const std::string& path )
+{
+	size_t dot = path.find_last_of( '.' );
+	size_t slash = path.find_last_of( "/\\" );
+	
+	if ( dot == std::string::npos || ( slash != std::string::npos && dot < slash ) )
+		return path + PARTICLE_BINARY_EXTENSION;
+	
+	return path.substr( 0, dot ) + PARTICLE_BINARY_EXTENSION;
+}
+
+// ------------------------------------------------------------------------
+// Loading
+// ------------------------------------------------------------------------
+
+ofxParticleEmitterConfigPtr ofxParticleBinaryConfig::load( const std::string& path )
+{
+	Poco::SharedPtr<ofxParticleMappedFile> file( new ofxParticleMappedFile() );
+	if ( !file->open( path ) )
+	{
+		ofLog( OF_LOG_ERROR, "ofxParticleBinaryConfig::load() - unable to map " + path );
+		return ofxParticleEmitterConfigPtr();
+	}
+	
+	const unsigned char* data = file->getData();
+	size_t size = file->getSize();
+	
+	// Mappings are page aligned, so the header can be read where it lies
+	const ParticleBinaryHeader* header = (const ParticleBinaryHeader*)data;
+	
+	if ( size < sizeof( ParticleBinaryHeader ) || memcmp( header->magic, PARTICLE_BINARY_MAGIC, 4 ) != 0 )
+	{
+		ofLog( OF_LOG_ERROR, "ofxParticleBinaryConfig::load() - too short or not a compiled config " + path );
+		return ofxParticleEmitterConfigPtr();
+	}
+	
+	if ( header->byteOrder != PARTICLE_BINARY_BYTE_ORDER || header->version != PARTICLE_BINARY_VERSION || 
+		 header->headerSize != sizeof( ParticleBinaryHeader ) )
+	{
+		ofLog( OF_LOG_ERROR, "ofxParticleBinaryConfig::load() - unsupported version or byte order in " + path );
+		return ofxParticleEmitterConfigPtr();
+	}
+	
+	size_t pixelSize = (size_t)header->textureWidth * header->textureHeight * header->textureChannels;
+	bool namesFit = header->textureNameOffset <= size && header->textureNameLength <= size - header->textureNameOffset;
+	bool pixelsFit = header->textureOffset <= size && header->textureSize <= size - header->textureOffset;
+	
+	if ( !namesFit || !pixelsFit || ( header->textureSize != 0 && header->textureSize != pixelSize ) )
+	{
+		ofLog( OF_LOG_ERROR, "ofxParticleBinaryConfig::load() - truncated or damaged file " + path );
+		return ofxParticleEmitterConfigPtr();
+	}
+	
+	const ParticleBinaryRecord& record = header->record;
+	ofxParticleEmitterConfig* config = new ofxParticleEmitterConfig();
+	
+	config->filename					= path;
+	config->textureName.assign( (const char*)data + header->textureNameOffset, header->textureNameLength );
+	
+	config->emitterType					= record.emitterType;
+	config->sourcePosition				= record.sourcePosition;
+	config->angle						= record.angle;
+	config->angleVariance				= record.angleVariance;
+	config->speed						= record.speed;
+	config->speedVariance				= record.speedVariance;
+	config->radialAcceleration			= record.radialAcceleration;
+	config->tangentialAcceleration		= record.tangentialAcceleration;
+	config->gravity						= record.gravity;
+	config->particleLifespan			= record.particleLifespan;
+	config->particleLifespanVariance	= record.particleLifespanVariance;
+	config->startColor					= record.startColor;
+	config->startColorVariance			= record.startColorVariance;
+	config->finishColor					= record.finishColor;
+	config->finishColorVariance			= record.finishColorVariance;
+	config->startParticleSize			= record.startParticleSize;
+	config->startParticleSizeVariance	= record.startParticleSizeVariance;
+	config->finishParticleSize			= record.finishParticleSize;
+	config->finishParticleSizeVariance	= record.finishParticleSizeVariance;
+	config->maxParticles				= record.maxParticles;
+	config->duration					= record.duration;
+	config->blendFuncSource				= record.blendFuncSource;
+	config->blendFuncDestination		= record.blendFuncDestination;
+	config->maxRadius					= record.maxRadius;
+	config->maxRadiusVariance			= record.maxRadiusVariance;
+	config->radiusSpeed					= record.radiusSpeed;
+	config->minRadius					= record.minRadius;
+	config->rotatePerSecond				= record.rotatePerSecond;
+	config->rotatePerSecondVariance		= record.rotatePerSecondVariance;
+	
+	// Embedded pixels are left in the mapping, which the config keeps open
+	if ( header->textureSize != 0 )
+	{
+		config->texturePixels	= data + header->textureOffset;
+		config->textureWidth	= header->textureWidth;
+		config->textureHeight	= header->textureHeight;
+		config->textureChannels	= header->textureChannels;
+		config->mapping			= file;
+	}
+	
+	return ofxParticleEmitterConfigPtr( config );
+}
+
+// ------------------------------------------------------------------------
+// Saving
+// ------------------------------------------------------------------------
+
+bool ofxParticleBinaryConfig::save( const ofxParticleEmitterConfig& config, const std::string& path, 
+								   const unsigned char* pixels, int width, int height, int channels )
+{
+	if ( pixels == NULL && config.texturePixels != NULL )
+	{
+		pixels = config.texturePixels;
+		width = config.textureWidth;
+		height = config.textureHeight;
+		channels = config.textureChannels;
+	}
+	
+	size_t pixelSize = pixels != NULL ? (size_t)width * height * channels : 0;
+	
+	ParticleBinaryHeader header;
+	memset( &header, 0, sizeof( header ) );
+	
+	memcpy( header.magic, PARTICLE_BINARY_MAGIC, 4 );
+	header.version				= PARTICLE_BINARY_VERSION;
+	header.byteOrder			= PARTICLE_BINARY_BYTE_ORDER;
+	header.headerSize			= sizeof( ParticleBinaryHeader );
+	header.textureNameOffset	= sizeof( ParticleBinaryHeader );
+	header.textureNameLength	= (GLuint)config.textureName.size();
+	
+	if ( pixelSize != 0 )
+	{
+		size_t end = header.textureNameOffset + header.textureNameLength;
+		header.textureOffset	= (GLuint)( ( end + PARTICLE_BINARY_ALIGNMENT - 1 ) / PARTICLE_BINARY_ALIGNMENT * PARTICLE_BINARY_ALIGNMENT );
+		header.textureSize		= (GLuint)pixelSize;
+		header.textureWidth		= width;
+		header.textureHeight	= height;
+		header.textureChannels	= channels;
+	}
+	
+	ParticleBinaryRecord& record = header.record;
+	
+	record.emitterType					= config.emitterType;
+	record.sourcePosition				= config.sourcePosition;
+	record.angle						= config.angle;
+	record.angleVariance				= config.angleVariance;
+	record.speed						= config.speed;
+	record.speedVariance				= config.speedVariance;
+	record.radialAcceleration			= config.radialAcceleration;
+	record.tangentialAcceleration		= config.tangentialAcceleration;
+	record.gravity						= config.gravity;
+	record.particleLifespan				= config.particleLifespan;
+	record.particleLifespanVariance		= config.particleLifespanVariance;
+	record.startColor					= config.startColor;
+	record.startColorVariance			= config.startColorVariance;
+	record.finishColor					= config.finishColor;
+	record.finishColorVariance			= config.finishColorVariance;
+	record.startParticleSize			= config.startParticleSize;
+	record.startParticleSizeVariance	= config.startParticleSizeVariance;
+	record.finishParticleSize			= config.finishParticleSize;
+	record.finishParticleSizeVariance	= config.finishParticleSizeVariance;
+	record.maxParticles					= config.maxParticles;
+	record.duration						= config.duration;
+	record.blendFuncSource				= config.blendFuncSource;
+	record.blendFuncDestination			= config.blendFuncDestination;
+	record.maxRadius					= config.maxRadius;
+	record.maxRadiusVariance			= config.maxRadiusVariance;
+	record.radiusSpeed					= config.radiusSpeed;
+	record.minRadius					= config.minRadius;
+	record.rotatePerSecond				= config.rotatePerSecond;
+	record.rotatePerSecondVariance		= config.rotatePerSecondVariance;
+	
+	// Running emitters may have the file mapped, and truncating it under them would fault
+	// their next read of its pixels.  The new file is written beside it and renamed over
+	// it once complete, so they keep the old contents until they reload
+	std::string temporary = path + ".tmp";
+	
+	std::ofstream file( temporary.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+	if ( !file )
+	{
+		ofLog( OF_LOG_ERROR, "ofxParticleBinaryConfig::save() - unable to write " + path );
+		return false;
+	}
+	
+	file.write( (const char*)&header, sizeof( header ) );
+	file.write( config.textureName.data(), config.textureName.size() );
+	
+	if ( pixelSize != 0 )
+	{
+		static const char zeros[PARTICLE_BINARY_ALIGNMENT] = { 0 };
+		file.write( zeros, header.textureOffset - ( header.textureNameOffset + header.textureNameLength ) );
+		file.write( (const char*)pixels, pixelSize );
+	}
+	
+	file.close();
+	if ( !file )
+	{
+		ofLog( OF_LOG_ERROR, "ofxParticleBinaryConfig::save() - unable to write " + path );
+		remove( temporary.c_str() );
+		return false;
+	}
+	
+#ifdef TARGET_WIN32
+	bool renamed = MoveFileExA( temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING ) != 0;
+#else
+	bool renamed = rename( temporary.c_str(), path.c_str() ) == 0;
+#endif
+	
+	if ( !renamed )
+	{
+		ofLog( OF_LOG_ERROR, "ofxParticleBinaryConfig::save() - unable to replace " + path );
+		remove( temporary.c_str() );
+		return false;
+	}
+	
+	return true;
+}
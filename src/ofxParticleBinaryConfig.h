@@ -0,0 +1,111 @@
+//
+// ofxParticleBinaryConfig.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef _OFX_PARTICLE_BINARY_CONFIG
+#define _OFX_PARTICLE_BINARY_CONFIG
+
+#include "ofMain.h"
+#include "ofxParticleEmitterConfig.h"
+
+#define PARTICLE_BINARY_MAGIC			"PEXB"
+#define PARTICLE_BINARY_VERSION			1
+#define PARTICLE_BINARY_BYTE_ORDER		0x01020304		// Reads back differently on a machine of the other endianness
+#define PARTICLE_BINARY_EXTENSION		".pexb"
+#define PARTICLE_BINARY_ALIGNMENT		16				// Alignment of the embedded pixels within the file
+
+// ------------------------------------------------------------------------
+// Structures
+// ------------------------------------------------------------------------
+
+// Emitter settings as stored in a compiled config.  Every field is 4 bytes so the layout
+// is the same with any compiler
+typedef struct
+{
+	GLint		emitterType;
+	Vector3f	sourcePosition;
+	GLfloat		angle, angleVariance;
+	GLfloat		speed, speedVariance;
+	GLfloat		radialAcceleration, tangentialAcceleration;
+	Vector3f	gravity;
+	GLfloat		particleLifespan, particleLifespanVariance;
+	Color4f		startColor, startColorVariance;
+	Color4f		finishColor, finishColorVariance;
+	GLfloat		startParticleSize, startParticleSizeVariance;
+	GLfloat		finishParticleSize, finishParticleSizeVariance;
+	GLint		maxParticles;
+	GLfloat		duration;
+	GLint		blendFuncSource, blendFuncDestination;
+	GLfloat		maxRadius, maxRadiusVariance;
+	GLfloat		radiusSpeed;
+	GLfloat		minRadius;
+	GLfloat		rotatePerSecond, rotatePerSecondVariance;
+} ParticleBinaryRecord;
+
+// Start of a compiled config.  The texture name and the embedded pixels follow it, at the
+// offsets given from the start of the file
+typedef struct
+{
+	char		magic[4];				// PARTICLE_BINARY_MAGIC
+	GLuint		version;				// PARTICLE_BINARY_VERSION
+	GLuint		byteOrder;				// PARTICLE_BINARY_BYTE_ORDER
+	GLuint		headerSize;				// sizeof( ParticleBinaryHeader )
+	GLuint		textureNameOffset, textureNameLength;
+	GLuint		textureOffset, textureSize;		// Size is 0 when no pixels are embedded
+	GLint		textureWidth, textureHeight;
+	GLint		textureChannels;		// 1, 3 or 4 bytes per pixel, rows from the top
+	GLuint		reserved;
+	ParticleBinaryRecord	record;
+} ParticleBinaryHeader;
+
+// ------------------------------------------------------------------------
+// ofxParticleBinaryConfig
+// ------------------------------------------------------------------------
+
+// Reads and writes compiled emitter configs.  A compiled config is memory mapped and its
+// settings read straight from the mapping, and embedded pixels are used in place until
+// the config is released.  Files are only read on a machine of the same endianness as the
+// one which wrote them
+class ofxParticleBinaryConfig
+{
+	
+public:
+	
+	// True when the file at path starts with the compiled config magic
+	static bool		isBinary( const std::string& path );
+	
+	// Name of the compiled config which goes with a .pex file
+	static std::string	getCompiledName( const std::string& path );
+	
+	// Map and check a compiled config at path.  Null when the file is missing, truncated or
+	// from another version
+	static ofxParticleEmitterConfigPtr	load( const std::string& path );
+	
+	// Write config to path, embedding the sprite pixels when they are given.  A config which
+	// already carries embedded pixels keeps them when none are given.  The file is replaced
+	// by a rename, so configs which have the old one mapped keep reading it
+	static bool		save( const ofxParticleEmitterConfig& config, const std::string& path, 
+						  const unsigned char* pixels = NULL, int width = 0, int height = 0, int channels = 0 );
+};
+
+#endif
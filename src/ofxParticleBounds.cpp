@@ -0,0 +1,92 @@
+//
+// ofxParticleBounds.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "ofxParticleBounds.h"
+
+// ------------------------------------------------------------------------
+// Bounds
+// ------------------------------------------------------------------------
+
+bool ofxParticleBoundsIntersectsFrustum( const ParticleBounds& b, GLfloat x, GLfloat y, const ParticleFrustum& frustum )
+{
+	if ( ofxParticleBoundsIsEmpty( b ) )
+		return false;
+	
+	for ( int i = 0; i < 6; i++ )
+	{
+		const GLfloat* plane = frustum.planes[i];
+		
+		// The corner furthest along the plane's normal is the last to leave it
+		GLfloat px = ( plane[0] >= 0 ? b.maxX : b.minX ) + x;
+		GLfloat py = ( plane[1] >= 0 ? b.maxY : b.minY ) + y;
+		GLfloat pz = plane[2] >= 0 ? b.maxZ : b.minZ;
+		
+		if ( plane[0] * px + plane[1] * py + plane[2] * pz + plane[3] < 0 )
+			return false;
+	}
+	
+	return true;
+}
+
+// ------------------------------------------------------------------------
+// Frustum
+// ------------------------------------------------------------------------
+
+ParticleFrustum ofxParticleGetFrustum()
+{
+	GLfloat projection[16], modelview[16], m[16];
+	glGetFloatv( GL_PROJECTION_MATRIX, projection );
+	glGetFloatv( GL_MODELVIEW_MATRIX, modelview );
+	
+	for ( int column = 0; column < 4; column++ )
+		for ( int row = 0; row < 4; row++ )
+			m[column * 4 + row] = projection[row] * modelview[column * 4] + projection[4 + row] * modelview[column * 4 + 1] + 
+				projection[8 + row] * modelview[column * 4 + 2] + projection[12 + row] * modelview[column * 4 + 3];
+	
+	return ofxParticleFrustumFromMatrix( m );
+}
+
+ParticleFrustum ofxParticleFrustumFromMatrix( const GLfloat* m )
+{
+	// Each plane is the last row of the matrix plus or minus one of the others, so a point is
+	// inside when -w <= x, y, z <= w after the transform
+	ParticleFrustum frustum;
+	
+	for ( int i = 0; i < 6; i++ )
+	{
+		int row = i / 2;
+		GLfloat sign = ( i & 1 ) ? -1.0f : 1.0f;
+		GLfloat* plane = frustum.planes[i];
+		
+		for ( int c = 0; c < 4; c++ )
+			plane[c] = m[c * 4 + 3] + sign * m[c * 4 + row];
+		
+		// Normalized so the plane distances can be compared
+		GLfloat length = sqrtf( plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2] );
+		if ( length > 0 )
+			for ( int c = 0; c < 4; c++ )
+				plane[c] /= length;
+	}
+	
+	return frustum;
+}
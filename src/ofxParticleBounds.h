@@ -0,0 +1,106 @@
+//
+// ofxParticleBounds.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef _OFX_PARTICLE_BOUNDS
+#define _OFX_PARTICLE_BOUNDS
+
+#include "ofMain.h"
+
+// ------------------------------------------------------------------------
+// Structures
+// ------------------------------------------------------------------------
+
+// Axis aligned box.  An empty box has its minimum above its maximum
+typedef struct
+{
+	GLfloat		minX, minY, minZ;
+	GLfloat		maxX, maxY, maxZ;
+} ParticleBounds;
+
+// The six planes of a view frustum, each a, b, c, d with ax + by + cz + d >= 0 inside
+typedef struct
+{
+	GLfloat		planes[6][4];
+} ParticleFrustum;
+
+// ------------------------------------------------------------------------
+// Bounds
+// ------------------------------------------------------------------------
+
+static inline void ofxParticleBoundsClear( ParticleBounds& b )
+{
+	b.minX = b.minY = b.minZ = 1e30f;
+	b.maxX = b.maxY = b.maxZ = -1e30f;
+}
+
+static inline bool ofxParticleBoundsIsEmpty( const ParticleBounds& b )
+{
+	return b.minX > b.maxX;
+}
+
+// Grow the box to take in a sprite of the given half size, which covers it whichever way
+// it faces
+static inline void ofxParticleBoundsAdd( ParticleBounds& b, GLfloat x, GLfloat y, GLfloat z, GLfloat radius )
+{
+	b.minX = MIN( b.minX, x - radius );
+	b.minY = MIN( b.minY, y - radius );
+	b.minZ = MIN( b.minZ, z - radius );
+	b.maxX = MAX( b.maxX, x + radius );
+	b.maxY = MAX( b.maxY, y + radius );
+	b.maxZ = MAX( b.maxZ, z + radius );
+}
+
+static inline void ofxParticleBoundsMerge( ParticleBounds& b, const ParticleBounds& other )
+{
+	b.minX = MIN( b.minX, other.minX );
+	b.minY = MIN( b.minY, other.minY );
+	b.minZ = MIN( b.minZ, other.minZ );
+	b.maxX = MAX( b.maxX, other.maxX );
+	b.maxY = MAX( b.maxY, other.maxY );
+	b.maxZ = MAX( b.maxZ, other.maxZ );
+}
+
+// True when the box, moved by x, y, overlaps the rect in x and y
+static inline bool ofxParticleBoundsIntersectsRect( const ParticleBounds& b, GLfloat x, GLfloat y, 
+												   GLfloat left, GLfloat top, GLfloat width, GLfloat height )
+{
+	return b.minX + x <= left + width && b.maxX + x >= left && 
+		b.minY + y <= top + height && b.maxY + y >= top;
+}
+
+// True unless the box, moved by x, y, is wholly outside one of the planes.  Boxes near a
+// corner of the frustum can pass while still out of view, which only costs a draw
+bool	ofxParticleBoundsIntersectsFrustum( const ParticleBounds& b, GLfloat x, GLfloat y, const ParticleFrustum& frustum );
+
+// ------------------------------------------------------------------------
+// Frustum
+// ------------------------------------------------------------------------
+
+// The frustum of the current GL projection and modelview matrices, in the coordinates
+// those matrices draw from.  Needs a GL context
+ParticleFrustum	ofxParticleGetFrustum();
+
+// The frustum of a column major projection times modelview matrix
+ParticleFrustum	ofxParticleFrustumFromMatrix( const GLfloat* m );
+
+#endif
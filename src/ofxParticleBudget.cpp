@@ -0,0 +1,213 @@
+//
+// ofxParticleBudget.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "ofxParticleBudget.h"
+#include <algorithm>
+
+// ------------------------------------------------------------------------
+// ofxParticleBudget
+// ------------------------------------------------------------------------
+
+ofxParticleBudget::ofxParticleBudget()
+{
+	particleLimit = 0;
+	timeLimit = 0;
+	falloff = PARTICLE_BUDGET_FALLOFF;
+	costPerParticle = 0;
+	particleCount = 0;
+	effectiveLimit = 0;
+}
+
+ofxParticleBudget& ofxParticleBudget::getShared()
+{
+	static ofxParticleBudget shared;
+	return shared;
+}
+
+void ofxParticleBudget::setParticleLimit( int particles )
+{
+	particleLimit = MAX( 0, particles );
+}
+
+int ofxParticleBudget::getParticleLimit() const
+{
+	return particleLimit;
+}
+
+void ofxParticleBudget::setTimeLimit( GLfloat seconds )
+{
+	timeLimit = MAX( 0, seconds );
+}
+
+GLfloat ofxParticleBudget::getTimeLimit() const
+{
+	return timeLimit;
+}
+
+void ofxParticleBudget::setDistanceFalloff( GLfloat distance )
+{
+	if ( distance <= 0 )
+	{
+		ofLog( OF_LOG_WARNING, "ofxParticleBudget::setDistanceFalloff() - the distance must be above 0" );
+		return;
+	}
+	
+	falloff = distance;
+}
+
+void ofxParticleBudget::add( ParticleBudgetEntry* entry )
+{
+	if ( std::find( entries.begin(), entries.end(), entry ) != entries.end() )
+		return;
+	
+	// A new emitter starts with all it asks for, the next update brings it into line
+	entry->scale = 1.0f;
+	entry->seconds = 0;
+	entries.push_back( entry );
+}
+
+void ofxParticleBudget::remove( ParticleBudgetEntry* entry )
+{
+	std::vector<ParticleBudgetEntry*>::iterator it = std::find( entries.begin(), entries.end(), entry );
+	if ( it != entries.end() )
+		entries.erase( it );
+}
+
+int ofxParticleBudget::getEntryCount() const
+{
+	return (int)entries.size();
+}
+
+int ofxParticleBudget::getParticleCount() const
+{
+	return particleCount;
+}
+
+int ofxParticleBudget::getEffectiveLimit() const
+{
+	return effectiveLimit;
+}
+
+void ofxParticleBudget::update( GLfloat aDelta )
+{
+	const int n = (int)entries.size();
+	
+	int demand = 0;
+	GLfloat seconds = 0;
+	particleCount = 0;
+	
+	for ( int i = 0; i < n; i++ ) {
+		demand += entries[i]->demand;
+		particleCount += entries[i]->live;
+		seconds += entries[i]->seconds;
+		entries[i]->seconds = 0;
+	}
+	
+	// The time limit is turned into particles from what they have been costing lately
+	int limit = particleLimit > 0 ? particleLimit : demand;
+	
+	if ( timeLimit > 0 && particleCount > 0 && seconds > 0 ) {
+		GLfloat cost = seconds / particleCount;
+		costPerParticle = costPerParticle > 0 ? costPerParticle + ( cost - costPerParticle ) * PARTICLE_BUDGET_SMOOTHING : cost;
+	}
+	if ( timeLimit > 0 && costPerParticle > 0 )
+		limit = MIN( limit, (int)( timeLimit / costPerParticle ) );
+	
+	effectiveLimit = limit;
+	share( limit );
+	
+	// Move each share towards its target.  Falling fast keeps within the limits, rising slowly
+	// keeps returning effects from bursting back in, and small rises are left until they add
+	// up so shares do not chase every change in the measured cost
+	for ( int i = 0; i < n; i++ ) {
+		ParticleBudgetEntry* entry = entries[i];
+		GLfloat change = targets[i] - entry->scale;
+		
+		if ( change > 0 && change < PARTICLE_BUDGET_DEADBAND && targets[i] < 1.0f )
+			continue;
+		
+		if ( change > 0 )
+			entry->scale += MIN( change, PARTICLE_BUDGET_RISE * aDelta );
+		else
+			entry->scale += MAX( change, -PARTICLE_BUDGET_FALL * aDelta );
+	}
+}
+
+void ofxParticleBudget::share( int limit )
+{
+	const int n = (int)entries.size();
+	
+	targets.assign( n, 0.0f );
+	weights.resize( n );
+	pending.clear();
+	
+	for ( int i = 0; i < n; i++ ) {
+		const ParticleBudgetEntry* entry = entries[i];
+		weights[i] = MAX( 0, entry->priority ) * falloff / ( falloff + MAX( 0, entry->distance ) );
+		if ( entry->demand > 0 )
+			pending.push_back( i );
+	}
+	
+	// Share the particles out by weight.  Emitters whose share covers all they ask for are
+	// given it and what they leave goes round again, until the rest all get less than they
+	// ask for
+	GLfloat remaining = (GLfloat)limit;
+	
+	while ( !pending.empty() )
+	{
+		GLfloat total = 0;
+		for ( size_t k = 0; k < pending.size(); k++ )
+			total += weights[pending[k]];
+		
+		// Emitters with no weight, a priority of 0, only get what the others leave, split
+		// evenly between them
+		if ( total <= 0 ) {
+			for ( size_t k = 0; k < pending.size(); k++ )
+				weights[pending[k]] = 1.0f;
+			total = (GLfloat)pending.size();
+		}
+		
+		size_t kept = 0;
+		GLfloat given = 0;
+		
+		for ( size_t k = 0; k < pending.size(); k++ ) {
+			int i = pending[k];
+			if ( remaining * weights[i] / total >= entries[i]->demand ) {
+				targets[i] = 1.0f;
+				given += entries[i]->demand;
+			} else {
+				pending[kept++] = i;
+			}
+		}
+		remaining -= given;
+		
+		if ( kept == pending.size() ) {
+			for ( size_t k = 0; k < pending.size(); k++ ) {
+				int i = pending[k];
+				targets[i] = remaining * weights[i] / total / entries[i]->demand;
+			}
+			break;
+		}
+		pending.resize( kept );
+	}
+}
@@ -0,0 +1,117 @@
+//
+// ofxParticleBudget.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef _OFX_PARTICLE_BUDGET
+#define _OFX_PARTICLE_BUDGET
+
+#include "ofMain.h"
+
+// ------------------------------------------------------------------------
+// Constants
+// ------------------------------------------------------------------------
+
+#define PARTICLE_BUDGET_FALLOFF		1000.0f		// Default distance at which an emitter counts half
+#define PARTICLE_BUDGET_DEADBAND	0.05f		// Smallest rise of a share acted on, below 1
+#define PARTICLE_BUDGET_FALL		2.0f		// Most a share drops per second
+#define PARTICLE_BUDGET_RISE		0.5f		// Most a share grows per second
+#define PARTICLE_BUDGET_SMOOTHING	0.1f		// Weight of each frame in the cost per particle
+
+// ------------------------------------------------------------------------
+// Structures
+// ------------------------------------------------------------------------
+
+// What one emitter tells the budget and what it is given back
+typedef struct
+{
+	GLfloat		priority;		// Set by the owner, relative to the other emitters
+	GLfloat		distance;		// Set by the owner, from the viewer
+	
+	GLint		demand;			// Reported by the emitter, its maxParticles
+	GLint		live;			// Reported by the emitter, particles alive after its last update
+	GLfloat		seconds;		// Reported by the emitter, update time since the budget last ran
+	
+	GLfloat		scale;			// Set by the budget, the part of demand the emitter may use
+} ParticleBudgetEntry;
+
+// ------------------------------------------------------------------------
+// ofxParticleBudget
+// ------------------------------------------------------------------------
+
+// Shares a limit on live particles, and on update time, between the emitters registered
+// with it, see ofxParticleEmitter::setBudget().  While the emitters ask for less than the
+// limits allow, each keeps all of its maxParticles.  Past that, each emitter's cap and
+// emission rate are scaled down, by weight, which is its priority lowered with distance.
+// Shares fall quickly and rise slowly, and small rises are ignored, so effects do not
+// pop.  Particles already alive are never removed, a smaller share only slows emission.
+// The budget is not locked, so emitters join and leave it, and it is updated, on the
+// thread which updates them, between their updates
+class ofxParticleBudget
+{
+	
+public:
+	
+	ofxParticleBudget();
+	
+	static ofxParticleBudget&	getShared();
+	
+	// Most particles alive across every emitter, 0 for no limit, the default
+	void	setParticleLimit( int particles );
+	int		getParticleLimit() const;
+	
+	// Most seconds per update the emitters may spend together, counted on every thread they
+	// run on.  0 for no limit, the default
+	void	setTimeLimit( GLfloat seconds );
+	GLfloat	getTimeLimit() const;
+	
+	// Distance at which an emitter counts half as much as one at the viewer, above 0
+	void	setDistanceFalloff( GLfloat distance );
+	
+	void	add( ParticleBudgetEntry* entry );
+	void	remove( ParticleBudgetEntry* entry );
+	
+	// Share the limits out again.  Call once per frame after the emitters have updated,
+	// with the time since the last call, which paces how fast the shares move
+	void	update( GLfloat aDelta );
+	
+	int		getEntryCount() const;
+	int		getParticleCount() const;		// Live particles at the last update
+	int		getEffectiveLimit() const;		// Particles the limits allowed at the last update
+	
+protected:
+	
+	void	share( int limit );
+	
+	std::vector<ParticleBudgetEntry*>	entries;
+	std::vector<GLfloat>				targets;	// Share each entry is moving towards
+	std::vector<GLfloat>				weights;
+	std::vector<int>					pending;	// Entries still to be given a share
+	
+	int			particleLimit;
+	GLfloat		timeLimit;
+	GLfloat		falloff;
+	GLfloat		costPerParticle;	// Smoothed update seconds per live particle
+	int			particleCount;
+	int			effectiveLimit;
+};
+
+#endif
@@ -0,0 +1,263 @@
+//
+// ofxParticleDepthSort.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "ofxParticleDepthSort.h"
+
+// ------------------------------------------------------------------------
+// ofxParticleDepthSort
+// ------------------------------------------------------------------------
+
+ofxParticleDepthSort::ofxParticleDepthSort()
+{
+	mode = kParticleDepthSortOff;
+	count = 0;
+	shifted = 0;
+	restarted = false;
+	backoff = 0;
+}
+
+void ofxParticleDepthSort::setMode( int aMode )
+{
+	mode = aMode;
+	
+	// Drop the last order so it is not drawn from, or carried, once stale
+	if ( mode == kParticleDepthSortOff )
+		count = shifted = 0;
+}
+
+int ofxParticleDepthSort::getMode() const
+{
+	return mode;
+}
+
+void ofxParticleDepthSort::shift( int n )
+{
+	if ( mode == kParticleDepthSortIncremental )
+		shifted += n;
+}
+
+const GLuint* ofxParticleDepthSort::getOrder() const
+{
+	return count > 0 ? &order[0] : NULL;
+}
+
+int ofxParticleDepthSort::getCount() const
+{
+	return count;
+}
+
+bool ofxParticleDepthSort::getLastRestarted() const
+{
+	return restarted;
+}
+
+const GLuint* ofxParticleDepthSort::sort( const void* sprites, size_t stride, int aCount, const GLfloat* modelview )
+{
+	restarted = false;
+	
+	if ( aCount <= 0 ) {
+		count = shifted = 0;
+		return NULL;
+	}
+	
+	computeKeys( sprites, stride, aCount, modelview );
+	
+	// Sprites move little between frames, so the last order is nearly sorted and a few
+	// insertion moves finish it.  Sprites which have moved a long way can need far more,
+	// and then it is cheaper to start again.  They are likely to keep doing so, so the next
+	// few sorts go straight to the radix sort, still starting from the last order so ties
+	// keep their places
+	if ( mode == kParticleDepthSortIncremental && count > 0 ) {
+		int kept = carryOrder( aCount );
+		if ( backoff > 0 ) {
+			backoff--;
+			radixSort( 0, aCount );
+		} else if ( !insertionSort( kept ) ) {
+			restarted = true;
+			backoff = PARTICLE_DEPTH_SORT_BACKOFF;
+			radixSort( 0, aCount );
+		} else if ( kept < aCount ) {
+			// Sprites new since the last sort are sorted on their own and merged in
+			radixSort( kept, aCount );
+			merge( kept, aCount );
+		}
+	} else {
+		order.resize( aCount );
+		for ( int i = 0; i < aCount; i++ )
+			order[i] = i;
+		radixSort( 0, aCount );
+	}
+	
+	count = aCount;
+	shifted = 0;
+	return &order[0];
+}
+
+void ofxParticleDepthSort::computeKeys( const void* sprites, size_t stride, int aCount, const GLfloat* modelview )
+{
+	depths.resize( aCount );
+	keys.resize( aCount );
+	
+	// Only the z row of the matrix is needed
+	const GLfloat mx = modelview[2], my = modelview[6], mz = modelview[10], mw = modelview[14];
+	
+	const GLfloat* first = (const GLfloat*)sprites;
+	GLfloat nearest = mx * first[0] + my * first[1] + mz * first[2] + mw;
+	GLfloat farthest = nearest;
+	
+	const char* sprite = (const char*)sprites;
+	for ( int i = 0; i < aCount; i++, sprite += stride )
+	{
+		const GLfloat* position = (const GLfloat*)sprite;
+		GLfloat depth = mx * position[0] + my * position[1] + mz * position[2] + mw;
+		depths[i] = depth;
+		nearest = MAX( nearest, depth );
+		farthest = MIN( farthest, depth );
+	}
+	
+	// The camera looks down -z, so the most negative depth is the farthest and gets key 0
+	const GLfloat range = nearest - farthest;
+	const GLfloat scale = range > 0 ? ( ( 1 << PARTICLE_DEPTH_SORT_BITS ) - 1 ) / range : 0;
+	
+	for ( int i = 0; i < aCount; i++ )
+		keys[i] = (GLuint)( ( depths[i] - farthest ) * scale );
+}
+
+int ofxParticleDepthSort::carryOrder( int aCount )
+{
+	// Indices refer to the sprites' places in their array.  The sprites retired from the
+	// front since the last sort are dropped and the rest moved down to where they are now,
+	// then any past the end are dropped too.  The ones left keep their last order and new
+	// sprites go on the end.  A sprite whose place was taken by another is simply a poor
+	// guess, which the sort still corrects
+	int kept = 0;
+	for ( int i = 0; i < count; i++ ) {
+		GLint index = (GLint)order[i] - shifted;
+		if ( index >= 0 && index < aCount )
+			order[kept++] = index;
+	}
+	
+	order.resize( aCount );
+	if ( kept == aCount )
+		return kept;
+	
+	// The places no kept sprite moved to are the new sprites
+	scratch.assign( aCount, 0 );
+	for ( int i = 0; i < kept; i++ )
+		scratch[order[i]] = 1;
+	
+	int added = kept;
+	for ( int i = 0; i < aCount; i++ )
+		if ( !scratch[i] )
+			order[added++] = i;
+	
+	return kept;
+}
+
+bool ofxParticleDepthSort::insertionSort( int n )
+{
+	// The keys are gathered into the order first, so the moves below only touch two
+	// arrays walked in step
+	runKeys.resize( n );
+	for ( int i = 0; i < n; i++ )
+		runKeys[i] = keys[order[i]];
+	
+	int budget = n * PARTICLE_DEPTH_SORT_SHIFTS;
+	GLuint* sorted = &order[0];
+	GLuint* sortedKeys = &runKeys[0];
+	
+	for ( int i = 1; i < n; i++ )
+	{
+		GLuint index = sorted[i];
+		GLuint key = sortedKeys[i];
+		
+		int j = i;
+		while ( j > 0 && sortedKeys[j - 1] > key )
+		{
+			sorted[j] = sorted[j - 1];
+			sortedKeys[j] = sortedKeys[j - 1];
+			j--;
+		}
+		sorted[j] = index;
+		sortedKeys[j] = key;
+		
+		// The order is still a whole permutation here, so it can be radix sorted
+		budget -= i - j;
+		if ( budget < 0 )
+			return false;
+	}
+	
+	return true;
+}
+
+void ofxParticleDepthSort::radixSort( int begin, int end )
+{
+	// Least significant digit first.  Each pass is stable, so equal keys keep the order the
+	// sort started from.  An even number of passes leaves the result back in order
+	scratch.resize( order.size() );
+	GLuint* source = &order[begin];
+	GLuint* target = &scratch[begin];
+	const int n = end - begin;
+	
+	const int buckets = 1 << PARTICLE_DEPTH_SORT_RADIX;
+	GLuint offsets[1 << PARTICLE_DEPTH_SORT_RADIX];
+	
+	for ( int shift = 0; shift < PARTICLE_DEPTH_SORT_BITS; shift += PARTICLE_DEPTH_SORT_RADIX )
+	{
+		memset( offsets, 0, sizeof( offsets ) );
+		for ( int i = 0; i < n; i++ )
+			offsets[( keys[source[i]] >> shift ) & ( buckets - 1 )]++;
+		
+		GLuint total = 0;
+		for ( int b = 0; b < buckets; b++ ) {
+			GLuint count = offsets[b];
+			offsets[b] = total;
+			total += count;
+		}
+		
+		for ( int i = 0; i < n; i++ ) {
+			GLuint index = source[i];
+			target[offsets[( keys[index] >> shift ) & ( buckets - 1 )]++] = index;
+		}
+		
+		GLuint* swap = source;
+		source = target;
+		target = swap;
+	}
+}
+
+void ofxParticleDepthSort::merge( int middle, int end )
+{
+	// Both runs are sorted.  Ties take the first run, the sprites sorted before
+	scratch.resize( order.size() );
+	int a = 0, b = middle, out = 0;
+	
+	while ( a < middle && b < end )
+		scratch[out++] = keys[order[b]] < keys[order[a]] ? order[b++] : order[a++];
+	while ( a < middle )
+		scratch[out++] = order[a++];
+	while ( b < end )
+		scratch[out++] = order[b++];
+	
+	order.swap( scratch );
+}
@@ -0,0 +1,100 @@
+//
+// ofxParticleDepthSort.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef _OFX_PARTICLE_DEPTH_SORT
+#define _OFX_PARTICLE_DEPTH_SORT
+
+#include "ofMain.h"
+
+// ------------------------------------------------------------------------
+// Constants
+// ------------------------------------------------------------------------
+
+#define PARTICLE_DEPTH_SORT_BITS		16		// Depths are quantized to keys of this many bits
+#define PARTICLE_DEPTH_SORT_RADIX		8		// Bits sorted by each radix pass
+#define PARTICLE_DEPTH_SORT_SHIFTS		4		// Moves per sprite an incremental sort may make before starting over
+#define PARTICLE_DEPTH_SORT_BACKOFF		16		// Radix sorts made after starting over before trying incrementally again
+
+// How sprites are put in depth order
+enum kParticleDepthSortModes
+{
+	kParticleDepthSortOff,			// Drawn in storage order
+	kParticleDepthSortRadix,		// Radix sorted from scratch every draw
+	kParticleDepthSortIncremental	// Insertion sorted from the last order, radix sorted when that moved too much
+};
+
+// ------------------------------------------------------------------------
+// ofxParticleDepthSort
+// ------------------------------------------------------------------------
+
+// Orders sprites back to front along the view, without moving them.  The result is an
+// index buffer holding the sprites' indices farthest first.  Depths are quantized over
+// the range the sprites cover, so sprites closer together than 1/65536 of it may swap,
+// and ties keep the order of the last sort so they do not flicker
+class ofxParticleDepthSort
+{
+	
+public:
+	
+	ofxParticleDepthSort();
+	
+	void	setMode( int mode );
+	int		getMode() const;
+	
+	// Sort count sprites, stride bytes apart, which start with x, y and z floats.  The
+	// depth is the eye space z of the column major modelview matrix, as returned by
+	// glGetFloatv( GL_MODELVIEW_MATRIX ).  Returns the order, valid until the next sort
+	const GLuint*	sort( const void* sprites, size_t stride, int count, const GLfloat* modelview );
+	
+	// Tell an incremental sort that the first n sprites of the last sort have gone and the
+	// rest moved down by n, as when ring and pool storage retire their oldest particles.
+	// Calls add up until the next sort
+	void			shift( int n );
+	
+	const GLuint*	getOrder() const;
+	int				getCount() const;
+	
+	// True when the last incremental sort had to fall back to the radix sort
+	bool			getLastRestarted() const;
+	
+protected:
+	
+	void	computeKeys( const void* sprites, size_t stride, int count, const GLfloat* modelview );
+	int		carryOrder( int count );
+	bool	insertionSort( int n );
+	void	radixSort( int begin, int end );
+	void	merge( int middle, int end );
+	
+	int						mode;
+	int						count;			// Sprites in order
+	int						shifted;		// Sprites retired from the front since the last sort
+	bool					restarted;
+	int						backoff;		// Radix sorts left before the next incremental attempt
+	std::vector<GLfloat>	depths;			// Eye space z of each sprite
+	std::vector<GLuint>		keys;			// Quantized depth of each sprite, smallest farthest
+	std::vector<GLuint>		order;			// Sprite indices back to front
+	std::vector<GLuint>		runKeys;		// Keys in the order being insertion sorted
+	std::vector<GLuint>		scratch;		// Second buffer for the radix passes and merges
+};
+
+#endif
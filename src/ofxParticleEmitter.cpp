@@ -22,29 +22,54 @@
 // THE SOFTWARE.
 
 #include "ofxParticleEmitter.h"
+#include "ofx3DParticleEmitter.h"
+#include <algorithm>
+
+// ------------------------------------------------------------------------
+// Helpers
+// ------------------------------------------------------------------------
+
+// Unit launch direction of a 3D particle, spread evenly over the cone around the direction
+// of angle.  height in -1..1 picks how far from the axis, from along it to the edge of the
+// cone, and turn is the angle around the axis whose sin and cos are passed in
+static inline void coneDirection( const ParticleEmitterConstants& constants, GLfloat height, GLfloat sinTurn, GLfloat cosTurn,
+								 GLfloat& x, GLfloat& y, GLfloat& z )
+{
+	GLfloat cosSpread = 1.0f - ( height + 1.0f ) * 0.5f * ( 1.0f - constants.coneCos );
+	GLfloat sinSpread = sqrtf( MAX( 0.0f, 1.0f - cosSpread * cosSpread ) );
+	
+	// The axis is in the xy plane, so the z axis and the axis turned by 90 degrees within the
+	// plane are both perpendicular to it
+	GLfloat across = sinSpread * cosTurn;
+	x = constants.axisX * cosSpread - constants.axisY * across;
+	y = constants.axisY * cosSpread + constants.axisX * across;
+	z = sinSpread * sinTurn;
+}
 
 // ------------------------------------------------------------------------
 // Lifecycle
 // ------------------------------------------------------------------------
 
-ofxParticleEmitter::ofxParticleEmitter()
+template <int Dim>
+ParticleEmitter<Dim>::ParticleEmitter()
 {
     init();
 }
 
-void ofxParticleEmitter::init() 
+template <int Dim>
+void ParticleEmitter<Dim>::init() 
 {
-	settings = NULL;
-	
 	emitterType = kParticleTypeGravity;
 	texture = NULL;
-	sourcePosition.x = sourcePosition.y = 0.0f;
-	sourcePositionVariance.x = sourcePositionVariance.y = 0.0f;
+	texRect.u0 = texRect.v0 = 0.0f;
+	texRect.u1 = texRect.v1 = 1.0f;
+	sourcePosition = Dimension::zero();
+	sourcePositionVariance = Dimension::zero();
 	angle = angleVariance = 0.0f;								
 	speed = speedVariance = 0.0f;	
 	radialAcceleration = tangentialAcceleration = 0.0f;
 	radialAccelVariance = tangentialAccelVariance = 0.0f;
-	gravity.x = gravity.y = 0.0f;
+	gravity = Dimension::zero();
 	particleLifespan = particleLifespanVariance = 0.0f;			
 	startColor.red = startColor.green = startColor.blue = startColor.alpha = 1.0f;
 	startColorVariance.red = startColorVariance.green = startColorVariance.blue = startColorVariance.alpha = 1.0f;
@@ -58,500 +83,2070 @@ void ofxParticleEmitter::init()
 	emitCounter = 0.0f;	
 	elapsedTime = 0.0f;
 	duration = -1;
-	lastUpdateMillis = 0;
     
 	blendFuncSource = blendFuncDestination = 0;
 
 	maxRadius = maxRadiusVariance = radiusSpeed = minRadius = 0.0f;
 	rotatePerSecond = rotatePerSecondVariance = 0.0f;
 	
-	active = useTexture = false;
-	particleIndex = 0;
-
-	verticesID = 0;
-	particles = NULL;
-	vertices = NULL;
+	active = useTexture = false;
+	particleIndex = 0;
+
+	particles = NULL;
+	allocationMode = kParticleAllocationCompact;
+	particleHead = 0;
+	vertices = NULL;
+	packedVertices = NULL;
+	packedOrigin = Dimension::zero();
+	ofxParticleBoundsClear( bounds );
+	vertexFormat = kParticleVertexFloat;
+
+	storageMode = kParticleStorageArray;
+	renderMode = kParticleRenderInstanced;
+	kernels = ofxParticleGetKernels();
+	memset( &constants, 0, sizeof( constants ) );
+	evaluationMode = kParticleEvaluateStep;
+	analyticState = false;
+	analyticClock = 0.0f;
+	
+	fixedTimestep = 0.0f;
+	accumulator = 0.0f;
+	
+	threadPool = NULL;
+	
+	budget = NULL;
+	memset( &budgetEntry, 0, sizeof( budgetEntry ) );
+	budgetEntry.priority = 1.0f;
+	budgetEntry.scale = 1.0f;
+	
+	configGeneration = 0;
+	
+	// Each emitter gets its own stream, seeded from the global generator so ofSeedRandom()
+	// still controls the whole application
+	rng.seed( (unsigned int)( RANDOM_0_TO_1() * 4294967295.0 ) );
+}
+
+template <int Dim>
+ParticleEmitter<Dim>::~ParticleEmitter()
+{
+	setBudget( NULL );
+	exit();
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::exit()
+{	
+	cancelLoad();
+	
+	if ( texture != NULL )
+		ofxParticleTextureCache::getShared().release( texture );
+	texture = NULL;
+	
+	// The arrays come from malloc() in setupArrays()
+	free( particles );
+	particles = NULL;
+	
+	free( vertices );
+	vertices = NULL;
+	
+	free( packedVertices );
+	packedVertices = NULL;
+	
+	pool.release();
+	
+	vertexStream.release();
+	
+	configFilename = "";
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::setStorageMode( int mode )
+{
+	storageMode = mode;
+}
+
+template <int Dim>
+int ParticleEmitter<Dim>::getStorageMode() const
+{
+	return storageMode;
+}
+
+template <int Dim>
+int ParticleEmitter<Dim>::getAllocationMode() const
+{
+	return allocationMode;
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::setVertexFormat( int format )
+{
+	// Packed vertices have no room for z
+	if ( Dim == 3 && format == kParticleVertexPacked )
+	{
+		ofLog( OF_LOG_WARNING, "ofxParticleEmitter::setVertexFormat() - packed vertices are 2D only" );
+		return;
+	}
+	
+#ifdef TARGET_OF_IPHONE
+	// Point sprites on OpenGL ES 1 need float positions and sizes
+	if ( format == kParticleVertexPacked )
+	{
+		ofLog( OF_LOG_WARNING, "ofxParticleEmitter::setVertexFormat() - packed vertices are not supported on this target" );
+		return;
+	}
+#endif
+	
+	vertexFormat = format;
+}
+
+template <int Dim>
+int ParticleEmitter<Dim>::getVertexFormat() const
+{
+	return vertexFormat;
+}
+
+template <int Dim>
+bool ParticleEmitter<Dim>::setKernelISA( int isa )
+{
+	const ParticleKernels* requested = ofxParticleGetKernels( isa );
+	if ( requested == NULL )
+	{
+		ofLog( OF_LOG_WARNING, "ofxParticleEmitter::setKernelISA() - instruction set not available on this machine" );
+		return false;
+	}
+	
+	kernels = requested;
+	return true;
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::setFixedTimestep( GLfloat updatesPerSecond )
+{
+	fixedTimestep = updatesPerSecond > 0 ? 1.0f / updatesPerSecond : 0.0f;
+	accumulator = 0.0f;
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::setEvaluationMode( int mode )
+{
+	// The pool switches representation on the next update
+	evaluationMode = mode;
+}
+
+template <int Dim>
+int ParticleEmitter<Dim>::getEvaluationMode() const
+{
+	return evaluationMode;
+}
+
+template <int Dim>
+bool ParticleEmitter<Dim>::isAnalytic() const
+{
+	return evaluationMode == kParticleEvaluateAnalytic && storageMode == kParticleStoragePool &&
+		emitterType == kParticleTypeGravity && radialAcceleration == 0 && tangentialAcceleration == 0;
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::setParallelUpdate( bool enabled, ofxParticleThreadPool* threads )
+{
+	if ( enabled )
+		threadPool = threads != NULL ? threads : &ofxParticleThreadPool::getShared();
+	else
+		threadPool = NULL;
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::setStreamMode( int mode )
+{
+	vertexStream.setMode( mode );
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::setRenderMode( int mode )
+{
+	renderMode = mode;
+}
+
+template <int Dim>
+int ParticleEmitter<Dim>::getRenderMode() const
+{
+	return renderMode;
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::setBudget( ofxParticleBudget* aBudget, GLfloat priority )
+{
+	budgetEntry.priority = priority;
+	if ( aBudget == budget )
+		return;
+	
+	if ( budget != NULL )
+		budget->remove( &budgetEntry );
+	
+	budget = aBudget;
+	budgetEntry.demand = maxParticles;
+	budgetEntry.live = particleCount;
+	budgetEntry.scale = 1.0f;
+	
+	if ( budget != NULL )
+		budget->add( &budgetEntry );
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::setBudgetDistance( GLfloat distance )
+{
+	budgetEntry.distance = distance;
+}
+
+template <int Dim>
+GLfloat ParticleEmitter<Dim>::getBudgetScale() const
+{
+	return budgetEntry.scale;
+}
+
+template <int Dim>
+int ParticleEmitter<Dim>::particleCap() const
+{
+	if ( budget == NULL || maxParticles <= 0 )
+		return maxParticles;
+	
+	return MAX( 1, MIN( (int)( maxParticles * budgetEntry.scale + 0.5f ), maxParticles ) );
+}
+
+template <int Dim>
+const ParticleBounds& ParticleEmitter<Dim>::getBounds() const
+{
+	return bounds;
+}
+
+template <int Dim>
+bool ParticleEmitter<Dim>::isVisible( GLfloat left, GLfloat top, GLfloat width, GLfloat height, int x, int y ) const
+{
+	return !ofxParticleBoundsIsEmpty( bounds ) && ofxParticleBoundsIntersectsRect( bounds, x, y, left, top, width, height );
+}
+
+template <int Dim>
+bool ParticleEmitter<Dim>::isVisible( const ParticleFrustum& frustum, int x, int y ) const
+{
+	return ofxParticleBoundsIntersectsFrustum( bounds, x, y, frustum );
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::setDepthSort( int mode )
+{
+	// Every 2D sprite is at the same depth
+	if ( Dim == 2 && mode != kParticleDepthSortOff )
+	{
+		ofLog( OF_LOG_WARNING, "ofxParticleEmitter::setDepthSort() - only 3D emitters are sorted" );
+		return;
+	}
+	
+	depthSort.setMode( mode );
+}
+
+template <int Dim>
+int ParticleEmitter<Dim>::getDepthSort() const
+{
+	return depthSort.getMode();
+}
+
+template <int Dim>
+size_t ParticleEmitter<Dim>::getBytesUploaded() const
+{
+	return vertexStream.getLastUploadBytes();
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::setTextureRegion( const ofTextureData& texData, const ParticleTexRect& rect )
+{
+	textureData = texData;
+	texRect = rect;
+}
+
+template <int Dim>
+ofImage* ParticleEmitter<Dim>::getTexture() const
+{
+	return texture;
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::seedRandom( unsigned int seed )
+{
+	rng.seed( seed );
+}
+
+template <int Dim>
+bool ParticleEmitter<Dim>::loadFromXml( const std::string& filename )
+{
+	// The file is parsed once however many emitters load it.  The generation is read first
+	// so a reload landing while this loads is still picked up
+	ofxParticleConfigCache& cache = ofxParticleConfigCache::getShared();
+	int generation = cache.getGeneration();
+	
+	if ( !loadFromConfig( cache.load( filename ) ) )
+		return false;
+	
+	configFilename = filename;
+	configGeneration = generation;
+	
+	return true;
+}
+
+template <int Dim>
+bool ParticleEmitter<Dim>::loadFromConfig( const ofxParticleEmitterConfigPtr& aConfig )
+{
+	cancelLoad();
+	
+	if ( aConfig.isNull() )
+	{
+		ofLog( OF_LOG_ERROR, "ofxParticleEmitter::loadFromConfig() - config is invalid!" );
+		return false;
+	}
+	
+	config = aConfig;
+	configFilename = "";
+	
+	// The arrays are replaced below, so the ring is dropped rather than unwound.  Left
+	// in place it would be turned over the old array with the new maxParticles
+	particleHead = 0;
+	
+	applyConfig();
+	applyTexture();
+	setupArrays();
+	createBuffers();
+	
+	active = true;
+	
+	return true;
+}
+
+template <int Dim>
+ofxParticleLoadHandle ParticleEmitter<Dim>::loadFromXmlAsync( const std::string& filename, ofxParticleLoader* loader )
+{
+	cancelLoad();
+	
+	// Hot reload only starts once the load has finished, see finishLoad()
+	configFilename = "";
+	configGeneration = ofxParticleConfigCache::getShared().getGeneration();
+	
+	loadRequest = new ofxParticleEmitterLoadRequest<ParticleEmitter>( this, filename );
+	( loader != NULL ? loader : &ofxParticleLoader::getShared() )->load( loadRequest );
+	
+	return loadRequest;
+}
+
+template <int Dim>
+bool ParticleEmitter<Dim>::isLoading()
+{
+	if ( loadRequest.isNull() )
+		return false;
+	
+	int state = loadRequest->getState();
+	return state == kParticleLoadQueued || state == kParticleLoadPreparing || state == kParticleLoadFinishing;
+}
+
+template <int Dim>
+bool ParticleEmitter<Dim>::finishLoad( int step, const ofxParticleEmitterConfigPtr& aConfig, const ofxParticlePixelsPtr& filePixels )
+{
+	// One GL step per call so the loader can spread them over frames.  The loader thread
+	// only reads and decodes, so until the first step the emitter keeps updating and
+	// drawing with its last config, and the new one is swapped in here on the GL thread
+	if ( step == 0 )
+	{
+		config = aConfig;
+		
+		// Drop the ring before maxParticles changes, as loadFromConfig() does
+		particleHead = 0;
+		
+		applyConfig();
+		setupArrays();
+		applyTexture( filePixels );
+		return false;
+	}
+	
+	createBuffers();
+	active = true;
+	configFilename = loadRequest->getFilename();
+	
+	return true;
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::cancelLoad()
+{
+	if ( loadRequest.isNull() )
+		return;
+	
+	loadRequest->cancel();
+	loadRequest = NULL;
+}
+
+template <int Dim>
+ofxParticleEmitterConfigPtr ParticleEmitter<Dim>::getConfig() const
+{
+	return config;
+}
+
+template <int Dim>
+ParticleEmitter<Dim>* ParticleEmitter<Dim>::clone() const
+{
+	ParticleEmitter* emitter = new ParticleEmitter();
+	
+	// Settings which have to be in place before the arrays are set up
+	emitter->storageMode = storageMode;
+	emitter->vertexFormat = vertexFormat;
+	emitter->renderMode = renderMode;
+	emitter->depthSort.setMode( depthSort.getMode() );
+	emitter->kernels = kernels;
+	emitter->evaluationMode = evaluationMode;
+	emitter->threadPool = threadPool;
+	emitter->fixedTimestep = fixedTimestep;
+	emitter->budgetEntry.distance = budgetEntry.distance;
+	emitter->setBudget( budget, budgetEntry.priority );
+	emitter->vertexStream.setMode( vertexStream.getMode() );
+	
+	if ( !config.isNull() )
+		emitter->loadFromConfig( config );
+	
+	// The clone follows the same file when it is reloaded
+	emitter->configFilename = configFilename;
+	emitter->configGeneration = configGeneration;
+	
+	return emitter;
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::applyConfig()
+{
+	const ofxParticleEmitterConfig& c = *config;
+	
+	emitterType					= c.emitterType;
+	
+	sourcePosition				= Dimension::make( c.sourcePosition.x, c.sourcePosition.y, c.sourcePosition.z );
+	
+	speed						= c.speed;
+	speedVariance				= c.speedVariance;
+	particleLifespan			= c.particleLifespan;
+	particleLifespanVariance	= c.particleLifespanVariance;
+	angle						= c.angle;
+	angleVariance				= c.angleVariance;
+	
+	gravity						= Dimension::make( c.gravity.x, c.gravity.y, c.gravity.z );
+	
+	radialAcceleration			= c.radialAcceleration;
+	tangentialAcceleration		= c.tangentialAcceleration;
+	
+	startColor					= c.startColor;
+	startColorVariance			= c.startColorVariance;
+	finishColor					= c.finishColor;
+	finishColorVariance			= c.finishColorVariance;
+	
+	maxParticles				= c.maxParticles;
+	startParticleSize			= c.startParticleSize;
+	startParticleSizeVariance	= c.startParticleSizeVariance;
+	finishParticleSize			= c.finishParticleSize;
+	finishParticleSizeVariance	= c.finishParticleSizeVariance;
+	duration					= c.duration;
+	blendFuncSource				= c.blendFuncSource;
+	blendFuncDestination		= c.blendFuncDestination;
+	
+	maxRadius					= c.maxRadius;
+	maxRadiusVariance			= c.maxRadiusVariance;
+	radiusSpeed					= c.radiusSpeed;
+	minRadius					= c.minRadius;
+	
+	rotatePerSecond				= c.rotatePerSecond;
+	rotatePerSecondVariance		= c.rotatePerSecondVariance;
+	
+	updateConstants();
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::applyTexture( const ofxParticlePixelsPtr& filePixels )
+{
+	const ofxParticleEmitterConfig& c = *config;
+	
+	if ( c.texturePixels == NULL && c.textureName == "" )
+		return;
+	
+	ofxParticleTextureCache& cache = ofxParticleTextureCache::getShared();
+	
+	// Emitters naming the same image share one copy of it.  Embedded pixels are used ahead
+	// of the file they came from, and files decoded by the loader thread are only uploaded
+	ofImage* previous = texture;
+	if ( c.texturePixels != NULL )
+	{
+		texture = cache.acquire( c.texturePixels, c.textureWidth, c.textureHeight, c.textureChannels );
+	}
+	else if ( !filePixels.isNull() )
+	{
+		texture = cache.acquire( &filePixels->pixels[0], filePixels->width, filePixels->height, filePixels->channels, c.textureName );
+	}
+	else
+	{
+		ofLog( OF_LOG_WARNING, "ofxParticleEmitter::applyTexture() - loading image file" );
+		texture = cache.acquire( c.textureName );
+	}
+	if ( previous != NULL )
+		cache.release( previous );
+	
+	if ( texture != NULL )
+	{
+		textureData = texture->getTextureReference().getTextureData();
+		texRect = ofxParticleQuadBatch::getTexRect( textureData );
+	}
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::updateConstants()
+{
+	// Pick the features the update needs.  Radial mode ignores acceleration and gravity
+	int features = 0;
+	if ( emitterType == kParticleTypeRadial ) {
+		features |= kParticleFeatureRadial;
+	} else {
+		if ( radialAcceleration != 0 || tangentialAcceleration != 0 )
+			features |= kParticleFeatureAccel;
+		if ( !Dimension::isZero( gravity ) )
+			features |= kParticleFeatureGravity;
+	}
+	
+	if ( startColor.red != finishColor.red || startColor.green != finishColor.green ||
+		startColor.blue != finishColor.blue || startColor.alpha != finishColor.alpha ||
+		startColorVariance.red != 0 || startColorVariance.green != 0 || startColorVariance.blue != 0 || startColorVariance.alpha != 0 ||
+		finishColorVariance.red != 0 || finishColorVariance.green != 0 || finishColorVariance.blue != 0 || finishColorVariance.alpha != 0 )
+		features |= kParticleFeatureColor;
+	
+	if ( startParticleSize != finishParticleSize || startParticleSizeVariance != 0 || finishParticleSizeVariance != 0 )
+		features |= kParticleFeatureSize;
+	
+	constants.features = features;
+	constants.radiusDelta = maxRadius / particleLifespan;
+	constants.angle = (GLfloat)DEGREES_TO_RADIANS(angle);
+	constants.angleVariance = (GLfloat)DEGREES_TO_RADIANS(angleVariance);
+	constants.rotatePerSecond = (GLfloat)DEGREES_TO_RADIANS(rotatePerSecond);
+	constants.rotatePerSecondVariance = (GLfloat)DEGREES_TO_RADIANS(rotatePerSecondVariance);
+	constants.axisX = cosf(constants.angle);
+	constants.axisY = sinf(constants.angle);
+	constants.coneCos = cosf(MIN(fabsf(constants.angleVariance), (GLfloat)PI));
+	
+	// Without lifespan variance the oldest particle is always the next to die, so the array
+	// can be used as a ring.  The pool packs its survivors once per update either way
+	int allocation = kParticleAllocationCompact;
+	if ( storageMode == kParticleStorageArray && particleLifespanVariance == 0 )
+		allocation = kParticleAllocationRing;
+	
+	if ( allocation != allocationMode ) {
+		linearizeParticles();
+		allocationMode = allocation;
+	}
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::setupArrays()
+{
+	// Loading again replaces the arrays of the last load
+	free( particles );
+	free( vertices );
+	free( packedVertices );
+	particles = NULL;
+	vertices = NULL;
+	packedVertices = NULL;
+	
+	// Allocate the memory necessary for the particle emitter arrays.  In pool mode the
+	// particle details live in the columns of the pool instead of the particles array
+	if ( storageMode == kParticleStoragePool )
+	{
+		pool.allocate( maxParticles, Dim );
+		particles = NULL;
+	}
+	else
+	{
+		particles = (Particle*)malloc( sizeof( Particle ) * maxParticles );
+	}
+	if ( vertexFormat == kParticleVertexPacked )
+	{
+		packedVertices = (PackedPointSprite*)malloc( sizeof( PackedPointSprite ) * maxParticles );
+		vertices = NULL;
+	}
+	else
+	{
+		vertices = (PointSprite*)malloc( sizeof( PointSprite ) * maxParticles );
+	}
+	
+	// If one of the arrays cannot be allocated throw an assertion as this is bad
+	assert( ( particles || pool.capacity ) && ( vertices || packedVertices ) );
+	
+	// Set the particle count to zero
+	particleCount = 0;
+	particleHead = 0;
+	ofxParticleBoundsClear( bounds );
+	
+	// Reset the elapsed time
+	elapsedTime = 0;
+	accumulator = 0;
+	analyticState = false;
+	analyticClock = 0;
+	lastUpdate.update();
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::createBuffers()
+{
+	// Size the stream for every particle drawn the way this emitter draws, so the first
+	// draw does not have to create it
+	size_t bytes = sizeof( PointSprite ) * maxParticles;
+	
+#ifndef TARGET_OF_IPHONE
+	if ( renderMode != kParticleRenderInstanced )
+		bytes = sizeof( ParticleQuadVertex ) * 4 * maxParticles;
+	else if ( vertexFormat == kParticleVertexPacked )
+		bytes = sizeof( PackedPointSprite ) * maxParticles;
+#endif
+	
+	vertexStream.allocate( bytes );
+}
+
+// ------------------------------------------------------------------------
+// Hot reload
+// ------------------------------------------------------------------------
+
+template <int Dim>
+bool ParticleEmitter<Dim>::checkForReload()
+{
+	if ( configFilename == "" )
+		return false;
+	
+	ofxParticleConfigCache& cache = ofxParticleConfigCache::getShared();
+	
+	int generation = cache.getGeneration();
+	if ( generation == configGeneration )
+		return false;
+	configGeneration = generation;
+	
+	ofxParticleEmitterConfigPtr latest = cache.find( configFilename );
+	if ( latest.isNull() || latest == config )
+		return false;
+	
+	reloadConfig( latest );
+	return true;
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::reloadConfig( const ofxParticleEmitterConfigPtr& aConfig )
+{
+	// Between frames nothing else is using the emitter, so the settings, texture and arrays
+	// all change together.  The elapsed time, emit counter and live particles carry on.  The
+	// ring is unwound first, as maxParticles may change
+	linearizeParticles();
+	config = aConfig;
+	
+	applyConfig();
+	applyTexture();
+	resizeArrays();
+	createBuffers();
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::resizeArrays()
+{
+	// Particles past a smaller maxParticles are dropped, the rest keep their place.  A file
+	// saved half way through can ask for none, which still keeps one slot allocated
+	int capacity = MAX( maxParticles, 1 );
+	
+	if ( storageMode == kParticleStoragePool )
+	{
+		pool.resize( capacity );
+		pool.count = MIN( pool.count, maxParticles );
+		particleCount = pool.count;
+	}
+	else
+	{
+		particles = (Particle*)realloc( particles, sizeof( Particle ) * capacity );
+		particleCount = MIN( particleCount, maxParticles );
+	}
+	if ( vertexFormat == kParticleVertexPacked )
+		packedVertices = (PackedPointSprite*)realloc( packedVertices, sizeof( PackedPointSprite ) * capacity );
+	else
+		vertices = (PointSprite*)realloc( vertices, sizeof( PointSprite ) * capacity );
+	
+	assert( ( particles || pool.capacity ) && ( vertices || packedVertices ) );
+	
+	particleIndex = MIN( particleIndex, particleCount );
+}
+
+// ------------------------------------------------------------------------
+// Particle Management
+// ------------------------------------------------------------------------
+
+template <int Dim>
+bool ParticleEmitter<Dim>::addParticle()
+{
+	// If we have already reached the maximum number of particles then do nothing
+	if(particleCount == maxParticles)
+		return false;
+	
+	// Take the next particle out of the particle pool we have created and initialize it
+	if ( storageMode == kParticleStoragePool )
+	{
+		Particle particle;
+		initParticle( &particle );
+		storeParticle( pool.count, &particle );
+		pool.count++;
+	}
+	else
+	{
+		Particle *particle = &particles[particleSlot( particleCount )];
+		initParticle( particle );
+	}
+	
+	// Increment the particle count
+	particleCount++;
+	
+	// Return true to show that a particle has been created
+	return true;
+}
+
+template <int Dim>
+int ParticleEmitter<Dim>::particleSlot( int index ) const
+{
+	// Live particles run on from particleHead, wrapping round the end of the array
+	index += particleHead;
+	return index < maxParticles ? index : index - maxParticles;
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::linearizeParticles()
+{
+	// Turn the ring so the oldest particle is back in the first slot, as the compact
+	// allocation mode, the prewarm and resizing all expect
+	if ( particleHead == 0 )
+		return;
+	
+	std::rotate( particles, particles + particleHead, particles + maxParticles );
+	particleHead = 0;
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::initParticle( Particle* particle )
+{
+	// Init the position of the particle.  This is based on the source position of the particle emitter
+	// plus a configured variance.  The emitters random stream returns numbers between -1 and 1 so the
+	// variance can be both positive and negative
+	particle->position.x = sourcePosition.x + sourcePositionVariance.x * rng.nextMinus1To1();
+	particle->position.y = sourcePosition.y + sourcePositionVariance.y * rng.nextMinus1To1();
+	if ( Dim == 3 )
+		Dimension::setZ( particle->position, Dimension::getZ( sourcePosition ) + Dimension::getZ( sourcePositionVariance ) * rng.nextMinus1To1() );
+    particle->startPos = sourcePosition;
+	
+	// Init the direction of the particle.  In 2D the newAngle is calculated using the angle passed in and
+	// the angle variance, in 3D the direction is picked from the cone around angle, see coneDirection()
+	Vector vector;
+	if ( Dim == 3 ) {
+		GLfloat height = rng.nextMinus1To1();
+		GLfloat turn = (GLfloat)PI * rng.nextMinus1To1();
+		GLfloat x, y, z;
+		coneDirection( constants, height, sinf(turn), cosf(turn), x, y, z );
+		vector = Dimension::make(x, y, z);
+	} else {
+		float newAngle = constants.angle + constants.angleVariance * rng.nextMinus1To1();
+		vector = Dimension::make(cosf(newAngle), sinf(newAngle), 0.0f);
+	}
+	
+	// Calculate the vectorSpeed using the speed and speedVariance which has been passed in
+	float vectorSpeed = speed + speedVariance * rng.nextMinus1To1();
+	
+	// The particles direction vector is calculated by taking the vector calculated above and
+	// multiplying that by the speed
+	particle->direction = Dimension::multiply(vector, vectorSpeed);
+	
+	// Set the default diameter of the particle from the source position
+	particle->radius = maxRadius + maxRadiusVariance * rng.nextMinus1To1();
+	particle->radiusDelta = constants.radiusDelta;
+	particle->angle = constants.angle + constants.angleVariance * rng.nextMinus1To1();
+	particle->degreesPerSecond = constants.rotatePerSecond + constants.rotatePerSecondVariance * rng.nextMinus1To1();
+    
+    particle->radialAcceleration = radialAcceleration;
+    particle->tangentialAcceleration = tangentialAcceleration;
+	
+	// Calculate the particles life span using the life span and variance passed in
+	particle->timeToLive = MAX(0, particleLifespan + particleLifespanVariance * rng.nextMinus1To1());
+	
+	// Calculate the particle size using the start and finish particle sizes
+	GLfloat particleStartSize = startParticleSize + startParticleSizeVariance * rng.nextMinus1To1();
+	GLfloat particleFinishSize = finishParticleSize + finishParticleSizeVariance * rng.nextMinus1To1();
+	particle->particleSizeDelta = (particleFinishSize - particleStartSize) / particle->timeToLive;
+	particle->particleSize = MAX(0, particleStartSize);
+	particle->previousPosition = particle->position;
+	particle->previousSize = particle->particleSize;
+	
+	// Calculate the color the particle should have when it starts its life.  All the elements
+	// of the start color passed in along with the variance are used to calculate the star color
+	Color4f start = {0, 0, 0, 0};
+	start.red = startColor.red + startColorVariance.red * rng.nextMinus1To1();
+	start.green = startColor.green + startColorVariance.green * rng.nextMinus1To1();
+	start.blue = startColor.blue + startColorVariance.blue * rng.nextMinus1To1();
+	start.alpha = startColor.alpha + startColorVariance.alpha * rng.nextMinus1To1();
+	
+	// Calculate the color the particle should be when its life is over.  This is done the same
+	// way as the start color above
+	Color4f end = {0, 0, 0, 0};
+	end.red = finishColor.red + finishColorVariance.red * rng.nextMinus1To1();
+	end.green = finishColor.green + finishColorVariance.green * rng.nextMinus1To1();
+	end.blue = finishColor.blue + finishColorVariance.blue * rng.nextMinus1To1();
+	end.alpha = finishColor.alpha + finishColorVariance.alpha * rng.nextMinus1To1();
+	
+	// Calculate the delta which is to be applied to the particles color during its life.  The delta
+	// calculation uses the life span of the particle to make sure that the particles color will
+	// transition from the start to end color during its life time.  The delta is a rate per second
+	// which update scales by the length of each step, so the result does not depend on frame rate
+	particle->color = start;
+	particle->deltaColor.red = (end.red - start.red) / particle->timeToLive;
+	particle->deltaColor.green = (end.green - start.green) / particle->timeToLive;
+	particle->deltaColor.blue = (end.blue - start.blue) / particle->timeToLive;
+	particle->deltaColor.alpha = (end.alpha - start.alpha) / particle->timeToLive;
+}
+
+template <int Dim>
+int ParticleEmitter<Dim>::emit( int count )
+{
+	return emitBurst( count, sourcePosition );
+}
+
+template <int Dim>
+int ParticleEmitter<Dim>::emitBurst( int count, const Vector& position )
+{
+	if ( MIN( count, particleCap() - particleCount ) <= 0 )
+		return 0;
+	
+	// The settings may have changed since the last update
+	updateConstants();
+	
+	return spawnParticles( count, position );
+}
+
+template <int Dim>
+int ParticleEmitter<Dim>::spawnParticles( int count, const Vector& position )
+{
+	count = MIN( count, particleCap() - particleCount );
+	if ( count <= 0 )
+		return 0;
+	
+	if ( storageMode == kParticleStoragePool )
+		return emitPool( count, position );
+	
+	// The array storage mode initializes one particle at a time around sourcePosition
+	Vector savedPosition = sourcePosition;
+	sourcePosition = position;
+	
+	int emitted = 0;
+	while ( emitted < count && addParticle() )
+		emitted++;
+	
+	sourcePosition = savedPosition;
+	
+	return emitted;
+}
+
+template <int Dim>
+int ParticleEmitter<Dim>::emitPool( int count, const Vector& origin )
+{
+	// Particles are initialized in blocks.  For each block the random values are generated
+	// in one go and laid out as one row per particle field, so every loop below streams
+	// through contiguous rows and columns and can be vectorized.  3D particles use two more
+	// rows, for z and for the turn of their launch direction
+	enum { kBlockSize = 128, kRandomRows = Dim == 3 ? 20 : 18 };
+	GLfloat random[kRandomRows][kBlockSize];
+	GLfloat angles[kBlockSize], sines[kBlockSize], cosines[kBlockSize];
+	
+	const GLfloat radiusDelta = constants.radiusDelta;
+	
+	int emitted = 0;
+	while ( emitted < count )
+	{
+		const int n = MIN( (int)kBlockSize, count - emitted );
+		const int first = pool.count;
+		int i;
+		
+		for ( int row = 0; row < kRandomRows; row++ )
+			rng.fillMinus1To1( random[row], n );
+		
+		// Init the position of the particles.  This is based on the origin plus a configured variance
+		GLfloat* px = pool.positionX + first;
+		GLfloat* py = pool.positionY + first;
+		GLfloat* sx = pool.startPosX + first;
+		GLfloat* sy = pool.startPosY + first;
+		for ( i = 0; i < n; i++ ) {
+			px[i] = origin.x + sourcePositionVariance.x * random[0][i];
+			py[i] = origin.y + sourcePositionVariance.y * random[1][i];
+			sx[i] = origin.x;
+			sy[i] = origin.y;
+		}
+		memcpy( pool.previousX + first, px, sizeof( GLfloat ) * n );
+		memcpy( pool.previousY + first, py, sizeof( GLfloat ) * n );
+		
+		if ( Dim == 3 ) {
+			GLfloat* pz = pool.positionZ + first;
+			GLfloat* sz = pool.startPosZ + first;
+			const GLfloat originZ = Dimension::getZ( origin );
+			const GLfloat varianceZ = Dimension::getZ( sourcePositionVariance );
+			for ( i = 0; i < n; i++ ) {
+				pz[i] = originZ + varianceZ * random[18][i];
+				sz[i] = originZ;
+			}
+			memcpy( pool.previousZ + first, pz, sizeof( GLfloat ) * n );
+		}
+		
+		// Init the direction of the particles from the angle, speed and their variances
+		GLfloat* dx = pool.directionX + first;
+		GLfloat* dy = pool.directionY + first;
+		if ( Dim == 3 ) {
+			GLfloat* dz = pool.directionZ + first;
+			for ( i = 0; i < n; i++ )
+				angles[i] = (GLfloat)PI * random[19][i];
+			kernels->sinCos( angles, sines, cosines, n );
+			
+			for ( i = 0; i < n; i++ ) {
+				GLfloat vectorSpeed = speed + speedVariance * random[3][i];
+				GLfloat x, y, z;
+				coneDirection( constants, random[2][i], sines[i], cosines[i], x, y, z );
+				dx[i] = x * vectorSpeed;
+				dy[i] = y * vectorSpeed;
+				dz[i] = z * vectorSpeed;
+			}
+		} else {
+			for ( i = 0; i < n; i++ )
+				angles[i] = constants.angle + constants.angleVariance * random[2][i];
+			kernels->sinCos( angles, sines, cosines, n );
+			
+			for ( i = 0; i < n; i++ ) {
+				GLfloat vectorSpeed = speed + speedVariance * random[3][i];
+				dx[i] = cosines[i] * vectorSpeed;
+				dy[i] = sines[i] * vectorSpeed;
+			}
+		}
+		
+		// Radial mode values
+		GLfloat* radius = pool.radius + first;
+		GLfloat* rd = pool.radiusDelta + first;
+		GLfloat* pa = pool.angle + first;
+		GLfloat* dps = pool.degreesPerSecond + first;
+		for ( i = 0; i < n; i++ ) {
+			radius[i] = maxRadius + maxRadiusVariance * random[4][i];
+			rd[i] = radiusDelta;
+			pa[i] = constants.angle + constants.angleVariance * random[5][i];
+			dps[i] = constants.rotatePerSecond + constants.rotatePerSecondVariance * random[6][i];
+		}
+		
+		GLfloat* ra = pool.radialAcceleration + first;
+		GLfloat* ta = pool.tangentialAcceleration + first;
+		GLfloat* ttl = pool.timeToLive + first;
+		for ( i = 0; i < n; i++ ) {
+			ra[i] = radialAcceleration;
+			ta[i] = tangentialAcceleration;
+			ttl[i] = MAX(0, particleLifespan + particleLifespanVariance * random[7][i]);
+		}
+		
+		// Size and its per update delta
+		GLfloat* size = pool.particleSize + first;
+		GLfloat* sizeDelta = pool.particleSizeDelta + first;
+		for ( i = 0; i < n; i++ ) {
+			GLfloat particleStartSize = startParticleSize + startParticleSizeVariance * random[8][i];
+			GLfloat particleFinishSize = finishParticleSize + finishParticleSizeVariance * random[9][i];
+			sizeDelta[i] = (particleFinishSize - particleStartSize) / ttl[i];
+			size[i] = MAX(0, particleStartSize);
+		}
+		memcpy( pool.previousSize + first, size, sizeof( GLfloat ) * n );
+		
+		// Start color and the per update delta which takes it to the finish color over the particles life
+		const GLfloat startBase[4] = { startColor.red, startColor.green, startColor.blue, startColor.alpha };
+		const GLfloat startVariance[4] = { startColorVariance.red, startColorVariance.green, startColorVariance.blue, startColorVariance.alpha };
+		const GLfloat finishBase[4] = { finishColor.red, finishColor.green, finishColor.blue, finishColor.alpha };
+		const GLfloat finishVariance[4] = { finishColorVariance.red, finishColorVariance.green, finishColorVariance.blue, finishColorVariance.alpha };
+		GLfloat* color[4] = { pool.colorRed + first, pool.colorGreen + first, pool.colorBlue + first, pool.colorAlpha + first };
+		GLfloat* deltaColor[4] = { pool.deltaColorRed + first, pool.deltaColorGreen + first, pool.deltaColorBlue + first, pool.deltaColorAlpha + first };
+		
+		for ( int channel = 0; channel < 4; channel++ ) {
+			const GLfloat* startRandom = random[10 + channel];
+			const GLfloat* finishRandom = random[14 + channel];
+			GLfloat* c = color[channel];
+			GLfloat* dc = deltaColor[channel];
+			for ( i = 0; i < n; i++ ) {
+				GLfloat start = startBase[channel] + startVariance[channel] * startRandom[i];
+				GLfloat end = finishBase[channel] + finishVariance[channel] * finishRandom[i];
+				c[i] = start;
+				dc[i] = (end - start) / ttl[i];
+			}
+		}
+		
+		// Analytic particles keep when they were spawned and when they die instead of the
+		// time they have left
+		if ( analyticState ) {
+			GLfloat* spawn = pool.spawnTime + first;
+			for ( i = 0; i < n; i++ ) {
+				spawn[i] = analyticClock;
+				ttl[i] += analyticClock;
+			}
+		}
+		
+		pool.count += n;
+		emitted += n;
+	}
+	
+	particleCount = pool.count;
+	
+	return emitted;
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::storeParticle( int index, const Particle* particle )
+{
+	// Scatter the fields of the particle into their columns
+	pool.positionX[index]				= particle->position.x;
+	pool.positionY[index]				= particle->position.y;
+	pool.directionX[index]				= particle->direction.x;
+	pool.directionY[index]				= particle->direction.y;
+	pool.startPosX[index]				= particle->startPos.x;
+	pool.startPosY[index]				= particle->startPos.y;
+	pool.colorRed[index]				= particle->color.red;
+	pool.colorGreen[index]				= particle->color.green;
+	pool.colorBlue[index]				= particle->color.blue;
+	pool.colorAlpha[index]				= particle->color.alpha;
+	pool.deltaColorRed[index]			= particle->deltaColor.red;
+	pool.deltaColorGreen[index]			= particle->deltaColor.green;
+	pool.deltaColorBlue[index]			= particle->deltaColor.blue;
+	pool.deltaColorAlpha[index]			= particle->deltaColor.alpha;
+	pool.radialAcceleration[index]		= particle->radialAcceleration;
+	pool.tangentialAcceleration[index]	= particle->tangentialAcceleration;
+	pool.radius[index]					= particle->radius;
+	pool.radiusDelta[index]				= particle->radiusDelta;
+	pool.angle[index]					= particle->angle;
+	pool.degreesPerSecond[index]		= particle->degreesPerSecond;
+	pool.particleSize[index]			= particle->particleSize;
+	pool.particleSizeDelta[index]		= particle->particleSizeDelta;
+	pool.timeToLive[index]				= particle->timeToLive;
+	pool.previousX[index]				= particle->position.x;
+	pool.previousY[index]				= particle->position.y;
+	pool.previousSize[index]			= particle->particleSize;
+	
+	if ( Dim == 3 ) {
+		pool.positionZ[index]			= Dimension::getZ( particle->position );
+		pool.directionZ[index]			= Dimension::getZ( particle->direction );
+		pool.startPosZ[index]			= Dimension::getZ( particle->startPos );
+		pool.previousZ[index]			= Dimension::getZ( particle->position );
+	}
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::storeVertex( int index, const Vector& position, GLfloat size, const Color4f& color )
+{
+	if ( vertexFormat == kParticleVertexPacked ) {
+		ofxParticlePackSprite( &packedVertices[index], position.x - packedOrigin.x, position.y - packedOrigin.y, size,
+							  color.red, color.green, color.blue, color.alpha );
+	} else {
+		vertices[index].x = position.x;
+		vertices[index].y = position.y;
+		Dimension::setZ( vertices[index], Dimension::getZ( position ) );
+		vertices[index].size = size;
+		vertices[index].color = color;
+	}
+	
+	ofxParticleBoundsAdd( bounds, position.x, position.y, Dimension::getZ( position ), size * 0.5f );
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::stopParticleEmitter()
+{
+	active = false;
+	elapsedTime = 0;
+	emitCounter = 0;
+}
+
+// ------------------------------------------------------------------------
+// Update
+// ------------------------------------------------------------------------
+
+template <int Dim>
+void ParticleEmitter<Dim>::update()
+{
+	// Measure the time since the last update with microsecond resolution
+	GLfloat aDelta = lastUpdate.elapsed() / 1000000.0f;
+	lastUpdate.update();
+	
+	update( aDelta );
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::update( GLfloat aDelta )
+{
+	checkForReload();
+	advance( aDelta );
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::advance( GLfloat aDelta )
+{
+	if ( budget == NULL ) {
+		simulate( aDelta );
+		return;
+	}
+	
+	// Report what the update cost and what is left alive, for the budget's next update
+	Poco::Timestamp start;
+	simulate( aDelta );
+	
+	budgetEntry.seconds += start.elapsed() / 1000000.0f;
+	budgetEntry.demand = maxParticles;
+	budgetEntry.live = particleCount;
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::simulate( GLfloat aDelta )
+{
+	if ( !active ) return;
+	
+	// Analytic particles are exact for any time step, so need neither fixed steps nor
+	// interpolation.  Converting keeps the particles alive whenever the config changes
+	if ( isAnalytic() )
+	{
+		if ( !analyticState )
+			toAnalytic();
+		stepAnalytic( aDelta );
+		evaluate();
+		return;
+	}
+	if ( analyticState )
+		fromAnalytic();
+	
+	// Without a fixed timestep the simulation advances by exactly the time which has passed
+	if ( fixedTimestep <= 0 )
+	{
+		step( aDelta );
+		if ( storageMode == kParticleStoragePool )
+			writeVertices( 1.0f );
+		return;
+	}
+	
+	// Otherwise run as many whole steps as fit in the time passed and carry the remainder over.
+	// After a long stall time is dropped rather than trying to catch up
+	accumulator += aDelta;
+	
+	int steps = (int)( accumulator / fixedTimestep );
+	if ( steps > MAXIMUM_STEPS_PER_UPDATE )
+	{
+		steps = MAXIMUM_STEPS_PER_UPDATE;
+		accumulator = steps * fixedTimestep;
+	}
+	
+	for ( int i = 0; i < steps; i++ )
+	{
+		// Keep the state before the last step so the render state can be blended between the two
+		if ( i == steps - 1 )
+			storePreviousState();
+		
+		step( fixedTimestep );
+		accumulator -= fixedTimestep;
+	}
+	
+	writeVertices( accumulator / fixedTimestep );
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::step( GLfloat aDelta )
+{
+	// The settings are public, so pick up any changes made since the config was applied
+	updateConstants();
+	
+	// Calculate the emission rate, for the part of maxParticles the budget allows
+	const int cap = particleCap();
+	emissionRate = cap / particleLifespan;
+	
+	// If the emitter is active and the emission rate is greater than zero then emit
+	// particles
+	if(active && emissionRate) {
+		float rate = 1.0f/emissionRate;
+		emitCounter += aDelta;
+		
+		// Work out how many particles are due and spawn them together
+		int due = 0;
+		while(particleCount + due < cap && emitCounter > rate) {
+			due++;
+			emitCounter -= rate;
+		}
+		spawnParticles( due, sourcePosition );
+		
+		elapsedTime += aDelta;
+		if(duration != -1 && duration < elapsedTime)
+			stopParticleEmitter();
+	}
+	
+	if ( storageMode == kParticleStoragePool )
+	{
+		updatePool( aDelta );
+		return;
+	}
+	
+	// Reset the particle index and bounds before updating the particles in this emitter
+	particleIndex = 0;
+	packedOrigin = sourcePosition;
+	ofxParticleBoundsClear( bounds );
+	
+	// Update the particles with the loop specialized for the features the settings use
+	(this->*stepParticlesTable[constants.features])( aDelta );
+}
+
+template <int Dim>
+bool ParticleEmitter<Dim>::updateParticle( Particle* particle, GLfloat aDelta )
+{
+	return (this->*updateParticleTable[constants.features])( particle, aDelta );
+}
+
+template <int Dim>
+template <int Features>
+void ParticleEmitter<Dim>::stepParticles( GLfloat aDelta )
+{
+	// Slot of the particle at the current particle index, which only differs from the index
+	// once the ring allocation mode has moved the head
+	int slot = particleHead;
+	
+	// Loop through all the particles updating their location and color
+	while(particleIndex < particleCount) {
+		
+		// Get the particle for the current particle index
+		Particle *currentParticle = &particles[slot];
+		
+		// If the current particle is alive then update it
+		if(integrateParticle<Features>(currentParticle, aDelta)) {
+			
+			// Place the position, size and color of the current particle into the vertices array
+			storeVertex( particleIndex, currentParticle->position, MAX(0, currentParticle->particleSize), currentParticle->color );
+			
+			// Update the particle counter
+			particleIndex++;
+			if(++slot == maxParticles)
+				slot = 0;
+		} else if(particleIndex == 0 && allocationMode == kParticleAllocationRing) {
+			
+			// The oldest particle has died, so retire it by moving the head of the ring past it.
+			// Nothing is copied
+			if(++particleHead == maxParticles)
+				particleHead = 0;
+			slot = particleHead;
+			particleCount--;
+			depthSort.shift(1);
+		} else {
+			
+			// As the particle is not alive anymore replace it with the last active particle 
+			// in the array and reduce the count of particles by one.  This causes all active particles
+			// to be packed together at the start of the array so that a particle which has run out of
+			// life will only drop into this clause once.  Rings only get here for radial particles
+			// which pass minRadius early
+			int last = particleSlot(particleCount - 1);
+			if(slot != last)
+				particles[slot] = particles[last];
+			particleCount--;
+		}
+	}
+}
+
+template <int Dim>
+template <int Features>
+bool ParticleEmitter<Dim>::integrateParticle( Particle* currentParticle, GLfloat aDelta )
+{
+	// FIX 1
+	// Reduce the life span of the particle
+	currentParticle->timeToLive -= aDelta;
+	
+	// A particle which has run out of life is left for the caller to remove
+	if(currentParticle->timeToLive <= 0)
+		return false;
+	
+	// The tests on Features are resolved when the template is instantiated, so each
+	// specialization only contains the math its settings need
+	if (Features & kParticleFeatureRadial) {
+		
+		// FIX 2
+		// Update the angle of the particle from the sourcePosition and the radius.  This is only
+		// done of the particles are rotating
+		currentParticle->angle += currentParticle->degreesPerSecond * aDelta;
+		currentParticle->radius -= currentParticle->radiusDelta * aDelta;
+		
+		// 3D particles spin in the plane of the source position
+		currentParticle->position = Dimension::make(sourcePosition.x - cosf(currentParticle->angle) * currentParticle->radius,
+													sourcePosition.y - sinf(currentParticle->angle) * currentParticle->radius,
+													Dimension::getZ(sourcePosition));
+		
+		if (currentParticle->radius < minRadius)
+			currentParticle->timeToLive = 0;
+	} else if (Features & kParticleFeatureAccel) {
+		Vector tmp, radial, tangential;
+		
+		radial = Dimension::zero();
+		Vector diff = currentParticle->startPos;
+		
+		currentParticle->position = Dimension::sub(currentParticle->position, diff);
+		
+		if (!Dimension::isZero(currentParticle->position))
+			radial = Dimension::normalize(currentParticle->position);
+		
+		// The tangential direction turns about the z axis
+		tangential = Dimension::perpendicular(radial);
+		radial = Dimension::multiply(radial, currentParticle->radialAcceleration);
+		tangential = Dimension::multiply(tangential, currentParticle->tangentialAcceleration);
+		
+		tmp = Dimension::add( Dimension::add(radial, tangential), gravity);
+		tmp = Dimension::multiply(tmp, aDelta);
+		currentParticle->direction = Dimension::add(currentParticle->direction, tmp);
+		tmp = Dimension::multiply(currentParticle->direction, aDelta);
+		currentParticle->position = Dimension::add(currentParticle->position, tmp);
+		currentParticle->position = Dimension::add(currentParticle->position, diff);
+	} else {
+		
+		// Without radial or tangential acceleration only gravity changes the direction
+		if (Features & kParticleFeatureGravity)
+			currentParticle->direction = Dimension::add(currentParticle->direction, Dimension::multiply(gravity, aDelta));
+		currentParticle->position = Dimension::add(currentParticle->position, Dimension::multiply(currentParticle->direction, aDelta));
+	}
+	
+	// Update the particles color
+	if (Features & kParticleFeatureColor) {
+		currentParticle->color.red += currentParticle->deltaColor.red * aDelta;
+		currentParticle->color.green += currentParticle->deltaColor.green * aDelta;
+		currentParticle->color.blue += currentParticle->deltaColor.blue * aDelta;
+		currentParticle->color.alpha += currentParticle->deltaColor.alpha * aDelta;
+	}
+	
+	// Update the particles size, which is clamped when it is written to the vertices
+	if (Features & kParticleFeatureSize)
+		currentParticle->particleSize += currentParticle->particleSizeDelta * aDelta;
+	
+	return true;
+}
+
+#define PARTICLE_STEP_4(n)		&ParticleEmitter<Dim>::template stepParticles<n>, &ParticleEmitter<Dim>::template stepParticles<n + 1>, \
+								&ParticleEmitter<Dim>::template stepParticles<n + 2>, &ParticleEmitter<Dim>::template stepParticles<n + 3>
+#define PARTICLE_UPDATE_4(n)	&ParticleEmitter<Dim>::template integrateParticle<n>, &ParticleEmitter<Dim>::template integrateParticle<n + 1>, \
+								&ParticleEmitter<Dim>::template integrateParticle<n + 2>, &ParticleEmitter<Dim>::template integrateParticle<n + 3>
+
+template <int Dim>
+const typename ParticleEmitter<Dim>::StepParticlesFunction ParticleEmitter<Dim>::stepParticlesTable[kParticleFeatureDepth] =
+{
+	PARTICLE_STEP_4(0), PARTICLE_STEP_4(4), PARTICLE_STEP_4(8), PARTICLE_STEP_4(12),
+	PARTICLE_STEP_4(16), PARTICLE_STEP_4(20), PARTICLE_STEP_4(24), PARTICLE_STEP_4(28)
+};
+
+template <int Dim>
+const typename ParticleEmitter<Dim>::UpdateParticleFunction ParticleEmitter<Dim>::updateParticleTable[kParticleFeatureDepth] =
+{
+	PARTICLE_UPDATE_4(0), PARTICLE_UPDATE_4(4), PARTICLE_UPDATE_4(8), PARTICLE_UPDATE_4(12),
+	PARTICLE_UPDATE_4(16), PARTICLE_UPDATE_4(20), PARTICLE_UPDATE_4(24), PARTICLE_UPDATE_4(28)
+};
+
+#undef PARTICLE_STEP_4
+#undef PARTICLE_UPDATE_4
+
+template <int Dim>
+void ParticleEmitter<Dim>::updatePool( GLfloat aDelta )
+{
+	const int chunks = ( pool.count + PARTICLE_CHUNK_SIZE - 1 ) / PARTICLE_CHUNK_SIZE;
+	
+	// The oldest particles lead the pool, so an incremental depth sort can follow them as
+	// they are retired
+	if ( depthSort.getMode() == kParticleDepthSortIncremental ) {
+		int retired = 0;
+		while ( retired < pool.count && pool.timeToLive[retired] <= aDelta )
+			retired++;
+		depthSort.shift( retired );
+	}
+	
+	if ( threadPool == NULL || chunks < 2 ) {
+		pool.count = retireRange( 0, pool.count, aDelta );
+		integrateRange( 0, pool.count, aDelta );
+		particleCount = pool.count;
+		return;
+	}
+	
+	// Retire dead particles inside each chunk in parallel, then close the gaps they left
+	// between the chunks.  Closing the gaps only moves whole runs of particles
+	chunkSurvivors.resize( chunks );
+	
+	ParticleUpdateJob<Dim> retire( this, ParticleUpdateJob<Dim>::kRetire, aDelta, pool.count );
+	threadPool->run( &retire, chunks );
+	
+	int count = chunkSurvivors[0];
+	for ( int chunk = 1; chunk < chunks; chunk++ ) {
+		pool.move( count, chunk * PARTICLE_CHUNK_SIZE, chunkSurvivors[chunk] );
+		count += chunkSurvivors[chunk];
+	}
+	pool.count = particleCount = count;
+	
+	ParticleUpdateJob<Dim> integrate( this, ParticleUpdateJob<Dim>::kIntegrate, aDelta, count );
+	threadPool->run( &integrate, ( count + PARTICLE_CHUNK_SIZE - 1 ) / PARTICLE_CHUNK_SIZE );
+}
+
+template <int Dim>
+int ParticleEmitter<Dim>::retireRange( int begin, int end, GLfloat aDelta )
+{
+	// Reduce the life span of every particle and retire the ones which have run out of life.
+	// Only the timeToLive column is streamed to find them
+	for( int i = begin; i < end; i++ )
+		pool.timeToLive[i] -= aDelta;
+	
+	return pool.compact( begin, end );
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::integrateRange( int begin, int end, GLfloat aDelta )
+{
+	ParticleKernelParams params;
+	params.delta = aDelta;
+	params.gravityX = gravity.x;
+	params.gravityY = gravity.y;
+	params.gravityZ = Dimension::getZ( gravity );
+	params.sourceX = sourcePosition.x;
+	params.sourceY = sourcePosition.y;
+	params.sourceZ = Dimension::getZ( sourcePosition );
+	params.minRadius = minRadius;
+	
+	// One kernel moves, colors and sizes the particles, built for just the features the
+	// settings use and the number of dimensions.  Radial particles which cross minRadius are
+	// flagged dead and retired on the next update, matching the array storage mode
+	kernels->integrate[constants.features | Dimension::features]( &pool, begin, end, &params );
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::storePreviousState()
+{
+	if ( storageMode != kParticleStoragePool ) {
+		for ( int i = 0; i < particleCount; i++ ) {
+			Particle* particle = &particles[particleSlot( i )];
+			particle->previousPosition = particle->position;
+			particle->previousSize = particle->particleSize;
+		}
+		return;
+	}
+	
+	memcpy( pool.previousX, pool.positionX, sizeof( GLfloat ) * pool.count );
+	memcpy( pool.previousY, pool.positionY, sizeof( GLfloat ) * pool.count );
+	memcpy( pool.previousSize, pool.particleSize, sizeof( GLfloat ) * pool.count );
+	if ( Dim == 3 )
+		memcpy( pool.previousZ, pool.positionZ, sizeof( GLfloat ) * pool.count );
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::writeVertices( GLfloat alpha )
+{
+	const int chunks = ( pool.count + PARTICLE_CHUNK_SIZE - 1 ) / PARTICLE_CHUNK_SIZE;
+	
+	packedOrigin = sourcePosition;
+	
+	ofxParticleBoundsClear( bounds );
+	
+	// The last step already wrote the array particles as they are now, so this rewrites
+	// them blended from the state before that step
+	if ( storageMode != kParticleStoragePool ) {
+		for ( int i = 0; i < particleCount; i++ ) {
+			const Particle* particle = &particles[particleSlot( i )];
+			Vector position = Dimension::add( particle->previousPosition,
+				Dimension::multiply( Dimension::sub( particle->position, particle->previousPosition ), alpha ) );
+			GLfloat size = particle->previousSize + ( particle->particleSize - particle->previousSize ) * alpha;
+			storeVertex( i, position, MAX( 0, size ), particle->color );
+		}
+		particleIndex = particleCount;
+		return;
+	}
+	
+	if ( threadPool != NULL && chunks > 1 ) {
+		chunkBounds.resize( chunks );
+		ParticleUpdateJob<Dim> job( this, ParticleUpdateJob<Dim>::kWriteVertices, alpha, pool.count );
+		threadPool->run( &job, chunks );
+		mergeChunkBounds( chunks );
+	} else {
+		writeVerticesRange( 0, pool.count, alpha, bounds );
+	}
+	
+	particleIndex = pool.count;
 }
 
-ofxParticleEmitter::~ofxParticleEmitter()
+template <int Dim>
+void ParticleEmitter<Dim>::mergeChunkBounds( int chunks )
 {
-	exit();
+	for ( int chunk = 0; chunk < chunks; chunk++ )
+		ofxParticleBoundsMerge( bounds, chunkBounds[chunk] );
 }
 
-void ofxParticleEmitter::exit()
-{	
-	if ( texture != NULL )
-		delete texture;
-	texture = NULL;
+template <int Dim>
+void ParticleEmitter<Dim>::writeVerticesRange( int begin, int end, GLfloat alpha, ParticleBounds& rangeBounds )
+{
+	int i;
+	
+	ofxParticleBoundsClear( rangeBounds );
+	
+	if ( vertexFormat == kParticleVertexPacked ) {
+		for( i = begin; i < end; i++ ) {
+			GLfloat x = pool.previousX[i] + ( pool.positionX[i] - pool.previousX[i] ) * alpha;
+			GLfloat y = pool.previousY[i] + ( pool.positionY[i] - pool.previousY[i] ) * alpha;
+			GLfloat size = pool.previousSize[i] + ( pool.particleSize[i] - pool.previousSize[i] ) * alpha;
+			ofxParticlePackSprite( &packedVertices[i], x - packedOrigin.x, y - packedOrigin.y, MAX(0, size),
+								  pool.colorRed[i], pool.colorGreen[i], pool.colorBlue[i], pool.colorAlpha[i] );
+			ofxParticleBoundsAdd( rangeBounds, x, y, 0, MAX(0, size) * 0.5f );
+		}
+		return;
+	}
 	
-	if ( particles != NULL )
-		delete particles;
-	particles = NULL;
+	// Place the position, size and color of every particle into the vertices array.  Position and
+	// size are blended from the state before the last fixed step by alpha
+	if ( alpha >= 1.0f ) {
+		for( i = begin; i < end; i++ ) {
+			vertices[i].x = pool.positionX[i];
+			vertices[i].y = pool.positionY[i];
+			vertices[i].size = MAX(0, pool.particleSize[i]);
+		}
+	} else {
+		for( i = begin; i < end; i++ ) {
+			vertices[i].x = pool.previousX[i] + ( pool.positionX[i] - pool.previousX[i] ) * alpha;
+			vertices[i].y = pool.previousY[i] + ( pool.positionY[i] - pool.previousY[i] ) * alpha;
+			vertices[i].size = MAX(0, pool.previousSize[i] + ( pool.particleSize[i] - pool.previousSize[i] ) * alpha);
+		}
+	}
 	
-	if ( vertices != NULL )
-		delete vertices;
-	vertices = NULL;
+	if ( Dim == 3 ) {
+		if ( alpha >= 1.0f ) {
+			for( i = begin; i < end; i++ )
+				Dimension::setZ( vertices[i], pool.positionZ[i] );
+		} else {
+			for( i = begin; i < end; i++ )
+				Dimension::setZ( vertices[i], pool.previousZ[i] + ( pool.positionZ[i] - pool.previousZ[i] ) * alpha );
+		}
+	}
 	
-	glDeleteBuffers( 1, &verticesID );
+	// The bounds are grown in the last pass, which touches each vertex anyway
+	for( i = begin; i < end; i++ ) {
+		vertices[i].color.red = pool.colorRed[i];
+		vertices[i].color.green = pool.colorGreen[i];
+		vertices[i].color.blue = pool.colorBlue[i];
+		vertices[i].color.alpha = pool.colorAlpha[i];
+		ofxParticleBoundsAdd( rangeBounds, vertices[i].x, vertices[i].y, Dimension::getZ( vertices[i] ), vertices[i].size * 0.5f );
+	}
 }
 
-bool ofxParticleEmitter::loadFromXml( const std::string& filename )
+// ------------------------------------------------------------------------
+// Analytic evaluation
+// ------------------------------------------------------------------------
+
+template <int Dim>
+void ParticleEmitter<Dim>::toAnalytic()
 {
-	bool ok = false;
-	
-	settings = new ofxXmlSettings();
-	
-	ok = settings->loadFile( filename );
-	if ( ok )
-	{
-		parseParticleConfig();
-		setupArrays();
-		
-		ok = active = true;
+	// The current state becomes the spawn state of a particle spawned now
+	for ( int i = 0; i < pool.count; i++ ) {
+		pool.spawnTime[i] = analyticClock;
+		pool.timeToLive[i] += analyticClock;
 	}
+	analyticState = true;
+}
 
-	delete settings;
-	settings = NULL;
+template <int Dim>
+void ParticleEmitter<Dim>::fromAnalytic()
+{
+	// Bring every particle to its current state so stepping can carry on from there
+	for ( int i = 0; i < pool.count; i++ ) {
+		GLfloat age = analyticClock - pool.spawnTime[i];
+		
+		pool.positionX[i] += ( pool.directionX[i] + 0.5f * gravity.x * age ) * age;
+		pool.positionY[i] += ( pool.directionY[i] + 0.5f * gravity.y * age ) * age;
+		pool.directionX[i] += gravity.x * age;
+		pool.directionY[i] += gravity.y * age;
+		if ( Dim == 3 ) {
+			pool.positionZ[i] += ( pool.directionZ[i] + 0.5f * Dimension::getZ( gravity ) * age ) * age;
+			pool.directionZ[i] += Dimension::getZ( gravity ) * age;
+		}
+		pool.colorRed[i] += pool.deltaColorRed[i] * age;
+		pool.colorGreen[i] += pool.deltaColorGreen[i] * age;
+		pool.colorBlue[i] += pool.deltaColorBlue[i] * age;
+		pool.colorAlpha[i] += pool.deltaColorAlpha[i] * age;
+		pool.particleSize[i] += pool.particleSizeDelta[i] * age;
+		pool.timeToLive[i] -= analyticClock;
+	}
+	storePreviousState();
 	
-	return ok;
+	analyticState = false;
 }
 
-void ofxParticleEmitter::parseParticleConfig()
+template <int Dim>
+void ParticleEmitter<Dim>::stepAnalytic( GLfloat aDelta )
 {
-	if ( settings == NULL )
-	{
-		ofLog( OF_LOG_ERROR, "ofxParticleEmitter::parseParticleConfig() - XML settings is invalid!" );
-		return;
+	// Keep the times small enough for float precision
+	if ( analyticClock > PARTICLE_ANALYTIC_EPOCH ) {
+		for ( int i = 0; i < pool.count; i++ ) {
+			pool.spawnTime[i] -= PARTICLE_ANALYTIC_EPOCH;
+			pool.timeToLive[i] -= PARTICLE_ANALYTIC_EPOCH;
+		}
+		analyticClock -= PARTICLE_ANALYTIC_EPOCH;
 	}
 	
-	settings->pushTag( "particleEmitterConfig" );
-
-	std::string imageFilename	= settings->getAttribute( "texture", "name", "" );
-	std::string imageData		= settings->getAttribute( "texture", "data", "" );
+	// Pick up setting changes once for all the slices
+	updateConstants();
 	
-	if ( imageFilename != "" )
-	{
-		ofLog( OF_LOG_WARNING, "ofxParticleEmitter::parseParticleConfig() - loading image file" );
-		
-		texture = new ofImage();
-		texture->loadImage( imageFilename );
-		texture->setUseTexture( true );
-		texture->setAnchorPercent( 0.5f, 0.5f );
-		
-		textureData = texture->getTextureReference().getTextureData();
-	}
-	else if ( imageData != "" )
-	{
-		// TODO
+	emissionRate = particleCap() / particleLifespan;
+	
+	// Nothing spawned before the longest lifespan can still be alive, so a long gap only
+	// moves the clocks on until then
+	GLfloat longest = particleLifespan + fabsf( particleLifespanVariance );
+	if ( aDelta > longest && emissionRate ) {
+		GLfloat skipped = aDelta - longest;
+		analyticClock += skipped;
+		emitCounter = fmodf( emitCounter + skipped, 1.0f / emissionRate );
+		elapsedTime += skipped;
+		aDelta = longest;
 		
-		ofLog( OF_LOG_ERROR, "ofxParticleEmitter::parseParticleConfig() - image data found but not yet implemented!" );
-		return;
+		if(duration != -1 && duration < elapsedTime) {
+			stopParticleEmitter();
+			return;
+		}
 	}
+	
+	// The rest runs in slices, so particles dying during it make room for later ones as they
+	// do when stepped.  An update of one frame is a single slice
+	int slices = MAX( 1, (int)ceilf( aDelta / PARTICLE_PREWARM_STEP ) );
+	for ( int i = 0; i < slices && active; i++ )
+		sliceAnalytic( aDelta / slices );
+}
 
-    emitterType					= settings->getAttribute( "emitterType", "value", emitterType );
+template <int Dim>
+void ParticleEmitter<Dim>::sliceAnalytic( GLfloat aDelta )
+{
+	analyticClock += aDelta;
 	
-	sourcePosition.x			= settings->getAttribute( "sourcePosition", "x", sourcePosition.x );
-	sourcePosition.y			= settings->getAttribute( "sourcePosition", "y", sourcePosition.y );
+	// Retire the particles whose time of death has passed.  Nothing else is written
+	pool.count = particleCount = pool.compact( 0, pool.count, analyticClock );
 	
-	speed						= settings->getAttribute( "speed", "value", speed );
-	speedVariance				= settings->getAttribute( "speedVariance", "value", speedVariance );
-	particleLifespan			= settings->getAttribute( "particleLifespan", "value", particleLifespan );
-	particleLifespanVariance	= settings->getAttribute( "particleLifespanVariance", "value", particleLifespanVariance );
-	angle						= settings->getAttribute( "angle", "value", angle );
-	angleVariance				= settings->getAttribute( "angleVariance", "value", angleVariance );
+	if ( !emissionRate )
+		return;
 	
-	gravity.x					= settings->getAttribute( "gravity", "x", gravity.x );
-	gravity.y					= settings->getAttribute( "gravity", "y", gravity.y );
+	// Spawn the particles which came due, as step() does, back dated to when each was due.
+	// Those held back by a full pool spawn at the start of the slice
+	GLfloat rate = 1.0f / emissionRate;
+	emitCounter += aDelta;
 	
-	radialAcceleration			= settings->getAttribute( "radialAcceleration", "value", radialAcceleration );
-	tangentialAcceleration		= settings->getAttribute( "tangentialAcceleration", "value", tangentialAcceleration );
+	int due = 0;
+	if ( emitCounter > rate ) {
+		due = MIN( (int)( emitCounter / rate ), particleCap() - particleCount );
+		emitCounter -= due * rate;
+	}
 	
-	startColor.red				= settings->getAttribute( "startColor", "red", startColor.red );
-	startColor.green			= settings->getAttribute( "startColor", "green", startColor.green );
-	startColor.blue				= settings->getAttribute( "startColor", "blue", startColor.blue );
-	startColor.alpha			= settings->getAttribute( "startColor", "alpha", startColor.alpha );
+	int first = pool.count;
+	int emitted = spawnParticles( due, sourcePosition );
 	
-	startColorVariance.red		= settings->getAttribute( "startColorVariance", "red", startColorVariance.red );
-	startColorVariance.green	= settings->getAttribute( "startColorVariance", "green", startColorVariance.green );
-	startColorVariance.blue		= settings->getAttribute( "startColorVariance", "blue", startColorVariance.blue );
-	startColorVariance.alpha	= settings->getAttribute( "startColorVariance", "alpha", startColorVariance.alpha );
+	for ( int k = 0; k < emitted; k++ ) {
+		GLfloat age = MIN( emitCounter + ( emitted - 1 - k ) * rate, aDelta );
+		pool.spawnTime[first + k] -= age;
+		pool.timeToLive[first + k] -= age;
+	}
+	pool.count = particleCount = first + pool.compact( first, pool.count, analyticClock );
 	
-	finishColor.red				= settings->getAttribute( "finishColor", "red", finishColor.red );
-	finishColor.green			= settings->getAttribute( "finishColor", "green", finishColor.green );
-	finishColor.blue			= settings->getAttribute( "finishColor", "blue", finishColor.blue );
-	finishColor.alpha			= settings->getAttribute( "finishColor", "alpha", finishColor.alpha );
+	elapsedTime += aDelta;
+	if(duration != -1 && duration < elapsedTime)
+		stopParticleEmitter();
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::evaluate()
+{
+	const int chunks = ( pool.count + PARTICLE_CHUNK_SIZE - 1 ) / PARTICLE_CHUNK_SIZE;
 	
-	finishColorVariance.red		= settings->getAttribute( "finishColorVariance", "red", finishColorVariance.red );
-	finishColorVariance.green	= settings->getAttribute( "finishColorVariance", "green", finishColorVariance.green );
-	finishColorVariance.blue	= settings->getAttribute( "finishColorVariance", "blue", finishColorVariance.blue );
-	finishColorVariance.alpha	= settings->getAttribute( "finishColorVariance", "alpha", finishColorVariance.alpha );
+	packedOrigin = sourcePosition;
 	
-	maxParticles				= settings->getAttribute( "maxParticles", "value", maxParticles );
-	startParticleSize			= settings->getAttribute( "startParticleSize", "value", startParticleSize );
-	startParticleSizeVariance	= settings->getAttribute( "startParticleSizeVariance", "value", startParticleSizeVariance );
-	finishParticleSize			= settings->getAttribute( "finishParticleSize", "value", finishParticleSize );
-	finishParticleSizeVariance	= settings->getAttribute( "finishParticleSizeVariance", "value", finishParticleSizeVariance );
-	duration					= settings->getAttribute( "duration", "value", duration );
-	blendFuncSource				= settings->getAttribute( "blendFuncSource", "value", blendFuncSource );
-	blendFuncDestination		= settings->getAttribute( "blendFuncDestination", "value", blendFuncDestination );
+	ofxParticleBoundsClear( bounds );
 	
-	maxRadius					= settings->getAttribute( "maxRadius", "value", maxRadius );
-	maxRadiusVariance			= settings->getAttribute( "maxRadiusVariance", "value", maxRadiusVariance );
-	radiusSpeed					= settings->getAttribute( "radiusSpeed", "value", radiusSpeed );
-	minRadius					= settings->getAttribute( "minRadius", "value", minRadius );
+	if ( threadPool != NULL && chunks > 1 ) {
+		chunkBounds.resize( chunks );
+		ParticleUpdateJob<Dim> job( this, ParticleUpdateJob<Dim>::kEvaluate, 0, pool.count );
+		threadPool->run( &job, chunks );
+		mergeChunkBounds( chunks );
+	} else {
+		evaluateRange( 0, pool.count, bounds );
+	}
 	
-	rotatePerSecond				= settings->getAttribute( "rotatePerSecond", "value", rotatePerSecond );
-	rotatePerSecondVariance		= settings->getAttribute( "rotatePerSecondVariance", "value", rotatePerSecondVariance );
+	particleIndex = pool.count;
 }
 
-void ofxParticleEmitter::setupArrays()
+template <int Dim>
+void ParticleEmitter<Dim>::evaluateRange( int begin, int end, ParticleBounds& rangeBounds )
 {
-	// Allocate the memory necessary for the particle emitter arrays
-	particles = (Particle*)malloc( sizeof( Particle ) * maxParticles );
-	vertices = (PointSprite*)malloc( sizeof( PointSprite ) * maxParticles );
-	
-	// If one of the arrays cannot be allocated throw an assertion as this is bad
-	assert( particles && vertices );
-	
-	// Generate the vertices VBO
-	glGenBuffers( 1, &verticesID );
-	
-	// Set the particle count to zero
-	particleCount = 0;
+	// Position from constant acceleration, color and size linear in age.  Only the vertices
+	// are written, so chunks never share anything
+	const GLfloat now = analyticClock;
+	const GLfloat halfGravityX = 0.5f * gravity.x;
+	const GLfloat halfGravityY = 0.5f * gravity.y;
+	const GLfloat halfGravityZ = 0.5f * Dimension::getZ( gravity );
+	
+	int i;
+	
+	ofxParticleBoundsClear( rangeBounds );
+	
+	if ( vertexFormat == kParticleVertexPacked ) {
+		for( i = begin; i < end; i++ ) {
+			GLfloat age = now - pool.spawnTime[i];
+			GLfloat x = pool.positionX[i] + ( pool.directionX[i] + halfGravityX * age ) * age;
+			GLfloat y = pool.positionY[i] + ( pool.directionY[i] + halfGravityY * age ) * age;
+			GLfloat size = MAX(0, pool.particleSize[i] + pool.particleSizeDelta[i] * age);
+			ofxParticlePackSprite( &packedVertices[i], x - packedOrigin.x, y - packedOrigin.y, size,
+								  pool.colorRed[i] + pool.deltaColorRed[i] * age,
+								  pool.colorGreen[i] + pool.deltaColorGreen[i] * age,
+								  pool.colorBlue[i] + pool.deltaColorBlue[i] * age,
+								  pool.colorAlpha[i] + pool.deltaColorAlpha[i] * age );
+			ofxParticleBoundsAdd( rangeBounds, x, y, 0, size * 0.5f );
+		}
+		return;
+	}
 	
-	// Reset the elapsed time
-	elapsedTime = 0;
+	for( i = begin; i < end; i++ ) {
+		GLfloat age = now - pool.spawnTime[i];
+		vertices[i].x = pool.positionX[i] + ( pool.directionX[i] + halfGravityX * age ) * age;
+		vertices[i].y = pool.positionY[i] + ( pool.directionY[i] + halfGravityY * age ) * age;
+		vertices[i].size = MAX(0, pool.particleSize[i] + pool.particleSizeDelta[i] * age);
+		vertices[i].color.red = pool.colorRed[i] + pool.deltaColorRed[i] * age;
+		vertices[i].color.green = pool.colorGreen[i] + pool.deltaColorGreen[i] * age;
+		vertices[i].color.blue = pool.colorBlue[i] + pool.deltaColorBlue[i] * age;
+		vertices[i].color.alpha = pool.colorAlpha[i] + pool.deltaColorAlpha[i] * age;
+		if ( Dim == 3 )
+			Dimension::setZ( vertices[i], pool.positionZ[i] + ( pool.directionZ[i] + halfGravityZ * age ) * age );
+		ofxParticleBoundsAdd( rangeBounds, vertices[i].x, vertices[i].y, Dimension::getZ( vertices[i] ), vertices[i].size * 0.5f );
+	}
 }
 
 // ------------------------------------------------------------------------
-// Particle Management
+// Prewarm
 // ------------------------------------------------------------------------
 
-bool ofxParticleEmitter::addParticle()
+template <int Dim>
+void ParticleEmitter<Dim>::prewarm( GLfloat seconds )
 {
-	// If we have already reached the maximum number of particles then do nothing
-	if(particleCount == maxParticles)
-		return false;
-	
-	// Take the next particle out of the particle pool we have created and initialize it
-	Particle *particle = &particles[particleCount];
-	initParticle( particle );
+	// The settings are public, so pick up any changes made since the config was applied
+	updateConstants();
 	
-	// Increment the particle count
-	particleCount++;
+	if ( !active || seconds <= 0 || particleLifespan <= 0 || maxParticles <= 0 )
+		return;
 	
-	// Return true to show that a particle has been created
-	return true;
-}
-
-void ofxParticleEmitter::initParticle( Particle* particle )
-{
-	// Init the position of the particle.  This is based on the source position of the particle emitter
-	// plus a configured variance.  The RANDOM_MINUS_1_TO_1 macro allows the number to be both positive
-	// and negative
-	particle->position.x = sourcePosition.x + sourcePositionVariance.x * RANDOM_MINUS_1_TO_1();
-	particle->position.y = sourcePosition.y + sourcePositionVariance.y * RANDOM_MINUS_1_TO_1();
-    particle->startPos.x = sourcePosition.x;
-    particle->startPos.y = sourcePosition.y;
+	// An emitter with a duration stops once it has run that long
+	bool stops = duration != -1 && elapsedTime + seconds > duration;
+	if ( stops )
+		seconds = MAX( 0, duration - elapsedTime );
 	
-	// Init the direction of the particle.  The newAngle is calculated using the angle passed in and the
-	// angle variance.
-	float newAngle = (GLfloat)DEGREES_TO_RADIANS(angle + angleVariance * RANDOM_MINUS_1_TO_1());
+	// Without radial or tangential acceleration a particle's state is a simple function of
+	// its age, so it can be aged in one go rather than stepped
+	bool solve = emitterType == kParticleTypeRadial || ( radialAcceleration == 0 && tangentialAcceleration == 0 );
 	
-	// Create a new Vector2f using the newAngle
-	Vector2f vector = Vector2fMake(cosf(newAngle), sinf(newAngle));
+	// Analytic particles already work this way, one update covers the whole time
+	if ( isAnalytic() )
+	{
+		advance( seconds );
+		if ( stops )
+			stopParticleEmitter();
+		
+		accumulator = 0;
+		lastUpdate.update();
+		return;
+	}
 	
-	// Calculate the vectorSpeed using the speed and speedVariance which has been passed in
-	float vectorSpeed = speed + speedVariance * RANDOM_MINUS_1_TO_1();
+	// Age the particles which are already alive
+	if ( storageMode == kParticleStoragePool )
+	{
+		if ( pool.count > 0 )
+		{
+			int steps = (int)ceilf( seconds / PARTICLE_PREWARM_STEP );
+			for ( int i = 0; i < steps; i++ )
+				updatePool( seconds / steps );
+		}
+	}
+	else
+	{
+		linearizeParticles();
+		
+		int alive = 0;
+		for ( int i = 0; i < particleCount; i++ )
+			if ( prewarmParticle( &particles[i], seconds, solve ) )
+				particles[alive++] = particles[i];
+		particleCount = alive;
+	}
 	
-	// The particles direction vector is calculated by taking the vector calculated above and
-	// multiplying that by the speed
-	particle->direction = Vector2fMultiply(vector, vectorSpeed);
+	// Create the particles emitted over that time, oldest first, each aged by the time since
+	// it was emitted.  Those emitted before the longest lifespan would already be dead, so
+	// emission starts no earlier than that
+	const int cap = particleCap();
+	GLfloat rate = particleLifespan / cap;
+	GLfloat longest = particleLifespan + fabsf( particleLifespanVariance );
 	
-	// Set the default diameter of the particle from the source position
-	particle->radius = maxRadius + maxRadiusVariance * RANDOM_MINUS_1_TO_1();
-	particle->radiusDelta = (maxRadius / particleLifespan) * (1.0 / MAXIMUM_UPDATE_RATE);
-	particle->angle = DEGREES_TO_RADIANS(angle + angleVariance * RANDOM_MINUS_1_TO_1());
-	particle->degreesPerSecond = DEGREES_TO_RADIANS(rotatePerSecond + rotatePerSecondVariance * RANDOM_MINUS_1_TO_1());
-    
-    particle->radialAcceleration = radialAcceleration;
-    particle->tangentialAcceleration = tangentialAcceleration;
+	GLfloat t = MAX( 0, rate - emitCounter );
+	GLfloat last = -emitCounter;
+	if ( seconds - t > longest )
+		t += ceilf( ( seconds - t - longest ) / rate ) * rate;
 	
-	// Calculate the particles life span using the life span and variance passed in
-	particle->timeToLive = MAX(0, particleLifespan + particleLifespanVariance * RANDOM_MINUS_1_TO_1());
+	for ( ; t <= seconds && particleCount < cap; t += rate )
+	{
+		Particle particle;
+		initParticle( &particle );
+		last = t;
+		
+		if ( !prewarmParticle( &particle, seconds - t, solve ) )
+			continue;
+		
+		if ( storageMode == kParticleStoragePool )
+			storeParticle( pool.count++, &particle );
+		else
+			particles[particleCount] = particle;
+		particleCount++;
+	}
 	
-	// Calculate the particle size using the start and finish particle sizes
-	GLfloat particleStartSize = startParticleSize + startParticleSizeVariance * RANDOM_MINUS_1_TO_1();
-	GLfloat particleFinishSize = finishParticleSize + finishParticleSizeVariance * RANDOM_MINUS_1_TO_1();
-	particle->particleSizeDelta = ((particleFinishSize - particleStartSize) / particle->timeToLive) * (1.0 / MAXIMUM_UPDATE_RATE);
-	particle->particleSize = MAX(0, particleStartSize);
+	emitCounter = seconds - last;
+	elapsedTime += seconds;
+	if ( stops )
+		stopParticleEmitter();
 	
-	// Calculate the color the particle should have when it starts its life.  All the elements
-	// of the start color passed in along with the variance are used to calculate the star color
-	Color4f start = {0, 0, 0, 0};
-	start.red = startColor.red + startColorVariance.red * RANDOM_MINUS_1_TO_1();
-	start.green = startColor.green + startColorVariance.green * RANDOM_MINUS_1_TO_1();
-	start.blue = startColor.blue + startColorVariance.blue * RANDOM_MINUS_1_TO_1();
-	start.alpha = startColor.alpha + startColorVariance.alpha * RANDOM_MINUS_1_TO_1();
+	// Write the vertices for the next draw
+	if ( storageMode == kParticleStoragePool )
+	{
+		storePreviousState();
+		writeVertices( 1.0f );
+	}
+	else
+	{
+		packedOrigin = sourcePosition;
+		ofxParticleBoundsClear( bounds );
+		for ( int i = 0; i < particleCount; i++ )
+			storeVertex( i, particles[i].position, MAX( 0, particles[i].particleSize ), particles[i].color );
+		particleIndex = particleCount;
+	}
 	
-	// Calculate the color the particle should be when its life is over.  This is done the same
-	// way as the start color above
-	Color4f end = {0, 0, 0, 0};
-	end.red = finishColor.red + finishColorVariance.red * RANDOM_MINUS_1_TO_1();
-	end.green = finishColor.green + finishColorVariance.green * RANDOM_MINUS_1_TO_1();
-	end.blue = finishColor.blue + finishColorVariance.blue * RANDOM_MINUS_1_TO_1();
-	end.alpha = finishColor.alpha + finishColorVariance.alpha * RANDOM_MINUS_1_TO_1();
-	
-	// Calculate the delta which is to be applied to the particles color during each cycle of its
-	// life.  The delta calculation uses the life span of the particle to make sure that the 
-	// particles color will transition from the start to end color during its life time.  As the game
-	// loop is using a fixed delta value we can calculate the delta color once saving cycles in the 
-	// update method
-	particle->color = start;
-	particle->deltaColor.red = ((end.red - start.red) / particle->timeToLive) * (1.0 / MAXIMUM_UPDATE_RATE);
-	particle->deltaColor.green = ((end.green - start.green) / particle->timeToLive)  * (1.0 / MAXIMUM_UPDATE_RATE);
-	particle->deltaColor.blue = ((end.blue - start.blue) / particle->timeToLive)  * (1.0 / MAXIMUM_UPDATE_RATE);
-	particle->deltaColor.alpha = ((end.alpha - start.alpha) / particle->timeToLive)  * (1.0 / MAXIMUM_UPDATE_RATE);
-}
-
-void ofxParticleEmitter::stopParticleEmitter()
-{
-	active = false;
-	elapsedTime = 0;
-	emitCounter = 0;
+	// The time spent here is not simulated again by the next update()
+	accumulator = 0;
+	lastUpdate.update();
 }
 
-// ------------------------------------------------------------------------
-// Update
-// ------------------------------------------------------------------------
-
-void ofxParticleEmitter::update()
+template <int Dim>
+bool ParticleEmitter<Dim>::prewarmParticle( Particle* particle, GLfloat age, bool solve )
 {
-	if ( !active ) return;
-
-	// Calculate the emission rate
-	emissionRate = maxParticles / particleLifespan;
-
-	GLfloat aDelta = (ofGetElapsedTimeMillis()-lastUpdateMillis)/1000.0f;
+	if ( age >= particle->timeToLive )
+		return false;
 	
-	// If the emitter is active and the emission rate is greater than zero then emit
-	// particles
-	if(active && emissionRate) {
-		float rate = 1.0f/emissionRate;
-		emitCounter += aDelta;
-		while(particleCount < maxParticles && emitCounter > rate) {
-			addParticle();
-			emitCounter -= rate;
-		}
+	if ( !solve )
+	{
+		// Large steps, which is as far as the accelerations can be trusted
+		int steps = (int)ceilf( age / PARTICLE_PREWARM_STEP );
+		for ( int i = 0; i < steps; i++ )
+			if ( !updateParticle( particle, age / steps ) )
+				return false;
 		
-		elapsedTime += aDelta;
-		if(duration != -1 && duration < elapsedTime)
-			stopParticleEmitter();
+		return particle->timeToLive > 0;
 	}
 	
-	// Reset the particle index before updating the particles in this emitter
-	particleIndex = 0;
+	particle->timeToLive -= age;
 	
-	// Loop through all the particles updating their location and color
-	while(particleIndex < particleCount) {
-		
-		// Get the particle for the current particle index
-		Particle *currentParticle = &particles[particleIndex];
-        
-        // FIX 1
-        // Reduce the life span of the particle
-        currentParticle->timeToLive -= aDelta;
+	if ( emitterType == kParticleTypeRadial )
+	{
+		// The angle and radius change at a constant rate
+		particle->angle += particle->degreesPerSecond * age;
+		particle->radius -= particle->radiusDelta * age;
+		if ( particle->radius < minRadius )
+			return false;
 		
-		// If the current particle is alive then update it
-		if(currentParticle->timeToLive > 0) {
-			
-			// If maxRadius is greater than 0 then the particles are going to spin otherwise
-			// they are effected by speed and gravity
-			if (emitterType == kParticleTypeRadial) {
-				
-                // FIX 2
-                // Update the angle of the particle from the sourcePosition and the radius.  This is only
-				// done of the particles are rotating
-				currentParticle->angle += currentParticle->degreesPerSecond * aDelta;
-				currentParticle->radius -= currentParticle->radiusDelta;
-                
-				Vector2f tmp;
-				tmp.x = sourcePosition.x - cosf(currentParticle->angle) * currentParticle->radius;
-				tmp.y = sourcePosition.y - sinf(currentParticle->angle) * currentParticle->radius;
-				currentParticle->position = tmp;
-				
-				if (currentParticle->radius < minRadius)
-					currentParticle->timeToLive = 0;
-			} else {
-				Vector2f tmp, radial, tangential;
-                
-                radial = Vector2fZero;
-                Vector2f diff = Vector2fSub(currentParticle->startPos, Vector2fZero);
-                
-                currentParticle->position = Vector2fSub(currentParticle->position, diff);
-                
-                if (currentParticle->position.x || currentParticle->position.y)
-                    radial = Vector2fNormalize(currentParticle->position);
-                
-                tangential.x = radial.x;
-                tangential.y = radial.y;
-                radial = Vector2fMultiply(radial, currentParticle->radialAcceleration);
-                
-                GLfloat newy = tangential.x;
-                tangential.x = -tangential.y;
-                tangential.y = newy;
-                tangential = Vector2fMultiply(tangential, currentParticle->tangentialAcceleration);
-                
-				tmp = Vector2fAdd( Vector2fAdd(radial, tangential), gravity);
-                tmp = Vector2fMultiply(tmp, aDelta);
-				currentParticle->direction = Vector2fAdd(currentParticle->direction, tmp);
-				tmp = Vector2fMultiply(currentParticle->direction, aDelta);
-				currentParticle->position = Vector2fAdd(currentParticle->position, tmp);
-                currentParticle->position = Vector2fAdd(currentParticle->position, diff);
-			}
-			
-			// Update the particles color
-			currentParticle->color.red += currentParticle->deltaColor.red;
-			currentParticle->color.green += currentParticle->deltaColor.green;
-			currentParticle->color.blue += currentParticle->deltaColor.blue;
-			currentParticle->color.alpha += currentParticle->deltaColor.alpha;
-			
-			// Place the position of the current particle into the vertices array
-			vertices[particleIndex].x = currentParticle->position.x;
-			vertices[particleIndex].y = currentParticle->position.y;
-			
-			// Place the size of the current particle in the size array
-			currentParticle->particleSize += currentParticle->particleSizeDelta;
-			vertices[particleIndex].size = MAX(0, currentParticle->particleSize);
-			
-			// Place the color of the current particle into the color array
-			vertices[particleIndex].color = currentParticle->color;
-			
-			// Update the particle counter
-			particleIndex++;
-		} else {
-			
-			// As the particle is not alive anymore replace it with the last active particle 
-			// in the array and reduce the count of particles by one.  This causes all active particles
-			// to be packed together at the start of the array so that a particle which has run out of
-			// life will only drop into this clause once
-			if(particleIndex != particleCount - 1)
-				particles[particleIndex] = particles[particleCount - 1];
-			particleCount--;
-		}
+		particle->position = Dimension::make( sourcePosition.x - cosf( particle->angle ) * particle->radius,
+											 sourcePosition.y - sinf( particle->angle ) * particle->radius,
+											 Dimension::getZ( sourcePosition ) );
+	}
+	else
+	{
+		// Constant acceleration from gravity alone
+		particle->position = Dimension::add( particle->position,
+			Dimension::multiply( Dimension::add( particle->direction, Dimension::multiply( gravity, 0.5f * age ) ), age ) );
+		particle->direction = Dimension::add( particle->direction, Dimension::multiply( gravity, age ) );
 	}
+	
+	particle->color.red += particle->deltaColor.red * age;
+	particle->color.green += particle->deltaColor.green * age;
+	particle->color.blue += particle->deltaColor.blue * age;
+	particle->color.alpha += particle->deltaColor.alpha * age;
+	particle->particleSize += particle->particleSizeDelta * age;
+	
+	return true;
+}
+
+// ------------------------------------------------------------------------
+// Parallel update
+// ------------------------------------------------------------------------
+
+template <int Dim>
+ParticleUpdateJob<Dim>::ParticleUpdateJob( ParticleEmitter<Dim>* emitter, int stage, GLfloat value, int count )
+: emitter( emitter ), stage( stage ), value( value ), count( count )
+{
+}
 
-	lastUpdateMillis = ofGetElapsedTimeMillis();
+template <int Dim>
+void ParticleUpdateJob<Dim>::run( int chunk )
+{
+	int begin = chunk * PARTICLE_CHUNK_SIZE;
+	int end = MIN( begin + PARTICLE_CHUNK_SIZE, count );
+	
+	switch ( stage ) {
+		case kRetire:
+			emitter->chunkSurvivors[chunk] = emitter->retireRange( begin, end, value );
+			break;
+		case kIntegrate:
+			emitter->integrateRange( begin, end, value );
+			break;
+		case kWriteVertices:
+			emitter->writeVerticesRange( begin, end, value, emitter->chunkBounds[chunk] );
+			break;
+		case kEvaluate:
+			emitter->evaluateRange( begin, end, emitter->chunkBounds[chunk] );
+			break;
+	}
 }
 
 // ------------------------------------------------------------------------
 // Render
 // ------------------------------------------------------------------------
 
-void ofxParticleEmitter::draw(int x /* = 0 */, int y /* = 0 */)
+template <int Dim>
+void ParticleEmitter<Dim>::draw(int x /* = 0 */, int y /* = 0 */)
 {
 	if ( !active ) return;
 	
 	glPushMatrix();
 	glTranslatef( x, y, 0.0f );
 	
+	// Packed vertices are relative to the position they were written around
+	if ( vertexFormat == kParticleVertexPacked )
+		glTranslatef( packedOrigin.x, packedOrigin.y, 0.0f );
+	
+	if ( depthSort.getMode() != kParticleDepthSortOff )
+		sortByDepth();
+	
 #ifdef TARGET_OF_IPHONE
 	
 	drawPointsOES();
 	
 #else
 	
-	drawTextures();
-	//drawPoints();
+	if ( renderMode != kParticleRenderInstanced || !drawInstanced() )
+		drawTextures();
 	
 #endif
 	
 	glPopMatrix();
 }
 
-void ofxParticleEmitter::drawTextures()
+template <int Dim>
+void ParticleEmitter<Dim>::drawTextures()
 {
+	if ( texture == NULL )
+		return;
+	
+	// Expand every live particle into a quad and submit them all at once
+	if ( vertexFormat == kParticleVertexPacked )
+		quadBatch.build( packedVertices, particleCount, texRect );
+	else
+		quadBatch.build( vertices, sizeof( PointSprite ), particleCount, texRect );
+	
 	glEnable(GL_BLEND);
 	glBlendFunc(blendFuncSource, blendFuncDestination);
 	
-	for( int i = 0; i < particleCount; i++ )
-	{
-		PointSprite* ps = &vertices[i];
-		ofSetColor( ps->color.red*255.0f, ps->color.green*255.0f, 
-				   ps->color.blue*255.0f, ps->color.alpha*255.0f );
-		texture->draw( ps->x, ps->y, ps->size, ps->size );
-	}
+	quadBatch.draw( textureData, &vertexStream );
 	
 	glDisable(GL_BLEND);
 }
 
-// this doesn't yet work, it is an attempt to port over the point sprite logic
-// from opengles. It draws the point sprites but it doesn't replace the point
-// size or color values. I left it here in case anyone wants to fix it :)
-void ofxParticleEmitter::drawPoints()
+template <int Dim>
+bool ParticleEmitter<Dim>::drawInstanced()
 {
-	// Disable the texture coord array so that texture information is not copied over when rendering
-	// the point sprites.
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-	
-	// Bind to the verticesID VBO and popuate it with the necessary vertex & color informaiton
-	glBindBuffer(GL_ARRAY_BUFFER, verticesID);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(PointSprite) * maxParticles, vertices, GL_DYNAMIC_DRAW);
-	
-	// Configure the vertex pointer which will use the currently bound VBO for its data
-	glVertexPointer(2, GL_FLOAT, sizeof(PointSprite), 0);
-	glColorPointer(4,GL_FLOAT,sizeof(PointSprite),(GLvoid*) (sizeof(GLfloat)*3));
-	
-	// Bind to the particles texture
-	glBindTexture(GL_TEXTURE_2D, (GLuint)textureData.textureID);
-	
-	// Enable the point size array
-	
-	
-	//glEnableClientState(GL_POINT_SIZE_ARRAY_OES);
-	
-	
-	// Configure the point size pointer which will use the currently bound VBO.  PointSprite contains
-	// both the location of the point as well as its size, so the config below tells the point size
-	// pointer where in the currently bound VBO it can find the size for each point
-	
-	
-	//glPointSizePointerOES(GL_FLOAT,sizeof(PointSprite),(GLvoid*) (sizeof(GL_FLOAT)*2));
-	
-	
-	// Change the blend function used if blendAdditive has been set
-	
-    // Set the blend function based on the configuration
-    glBlendFunc(blendFuncSource, blendFuncDestination);
-	
-	// Enable and configure point sprites which we are going to use for our particles
-	glEnable(GL_POINT_SPRITE);
-	glTexEnvi( GL_POINT_SPRITE, GL_COORD_REPLACE, GL_TRUE );
-	
-	// Now that all of the VBOs have been used to configure the vertices, pointer size and color
-	// use glDrawArrays to draw the points
-	glDrawArrays(GL_POINTS, 0, particleIndex);
-	
-	// Unbind the current VBO
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	
-	// Disable the client states which have been used incase the next draw function does 
-	// not need or use them
+	if ( texture == NULL )
+		return true;
+	
+	// Each sprite is sent as it is, one instance per particle
+	ParticleInstanceLayout layout;
+	const void* sprites;
+	
+	if ( vertexFormat == kParticleVertexPacked ) {
+		layout.stride = sizeof( PackedPointSprite );
+		layout.positionComponents = 2;
+		layout.positionType = PARTICLE_GL_HALF_FLOAT;
+		layout.positionOffset = offsetof( PackedPointSprite, x );
+		layout.sizeType = PARTICLE_GL_HALF_FLOAT;
+		layout.sizeOffset = offsetof( PackedPointSprite, size );
+		layout.colorType = GL_UNSIGNED_BYTE;
+		layout.colorNormalized = GL_TRUE;
+		layout.colorOffset = offsetof( PackedPointSprite, red );
+		sprites = packedVertices;
+	} else {
+		layout.stride = sizeof( PointSprite );
+		layout.positionComponents = Dim;
+		layout.positionType = GL_FLOAT;
+		layout.positionOffset = offsetof( PointSprite, x );
+		layout.sizeType = GL_FLOAT;
+		layout.sizeOffset = offsetof( PointSprite, size );
+		layout.colorType = GL_FLOAT;
+		layout.colorNormalized = GL_FALSE;
+		layout.colorOffset = offsetof( PointSprite, color );
+		sprites = getSortedVertices();
+	}
 	
+	glEnable(GL_BLEND);
+	glBlendFunc(blendFuncSource, blendFuncDestination);
 	
-	//glDisableClientState(GL_POINT_SIZE_ARRAY_OES);
+	bool drawn = ofxParticleInstanceRenderer::draw( textureData, texRect, sprites, particleCount, layout, &vertexStream );
 	
+	glDisable(GL_BLEND);
 	
-	glDisable(GL_POINT_SPRITE);
+	return drawn;
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::appendQuads( ofxParticleQuadBatch& batch, int x, int y )
+{
+	if ( !active || texture == NULL )
+		return;
 	
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// Positions are made absolute here, since the batch is drawn without each emitter's translation
+	if ( vertexFormat == kParticleVertexPacked )
+		batch.append( packedVertices, particleCount, texRect, x + packedOrigin.x, y + packedOrigin.y );
+	else
+		batch.append( vertices, sizeof( PointSprite ), particleCount, texRect, x, y );
+}
+
+template <int Dim>
+void ParticleEmitter<Dim>::sortByDepth()
+{
+	// Depth is measured with the matrix the sprites are about to be drawn with
+	GLfloat modelview[16];
+	glGetFloatv( GL_MODELVIEW_MATRIX, modelview );
 	
-	// Re-enable the texture coordinates as we use them elsewhere in the game and it is expected that
-	// its on
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	// Sort as many sprites as the draw below sends
+#ifdef TARGET_OF_IPHONE
+	depthSort.sort( vertices, sizeof( PointSprite ), particleIndex, modelview );
+#else
+	depthSort.sort( vertices, sizeof( PointSprite ), particleCount, modelview );
+#endif
+}
+
+template <int Dim>
+const typename ParticleEmitter<Dim>::PointSprite* ParticleEmitter<Dim>::getSortedVertices()
+{
+	const GLuint* order = depthSort.getOrder();
+	if ( depthSort.getMode() == kParticleDepthSortOff || order == NULL )
+		return vertices;
+	
+	// Instances and point sprites are drawn in array order, so the vertices are gathered
+	// in depth order on their way to the stream.  The particles themselves stay put
+	const int count = depthSort.getCount();
+	sortedVertices.resize( count );
+	for ( int i = 0; i < count; i++ )
+		sortedVertices[i] = vertices[order[i]];
+	
+	return &sortedVertices[0];
 }
 
-void ofxParticleEmitter::drawPointsOES()
+template <int Dim>
+void ParticleEmitter<Dim>::drawPointsOES()
 {
 #ifdef TARGET_OF_IPHONE
 	
@@ -559,13 +2154,12 @@ void ofxParticleEmitter::drawPointsOES()
 	// the point sprites.
 	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	
-	// Bind to the verticesID VBO and popuate it with the necessary vertex & color informaiton
-	glBindBuffer(GL_ARRAY_BUFFER, verticesID);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(PointSprite) * maxParticles, vertices, GL_DYNAMIC_DRAW);
+	// Stream the live particles into the vertex VBO, which leaves it bound
+	const char* base = (const char*)vertexStream.upload( getSortedVertices(), sizeof(PointSprite) * particleIndex );
 	
 	// Configure the vertex pointer which will use the currently bound VBO for its data
-	glVertexPointer(2, GL_FLOAT, sizeof(PointSprite), 0);
-	glColorPointer(4,GL_FLOAT,sizeof(PointSprite),(GLvoid*) (sizeof(GLfloat)*3));
+	glVertexPointer(Dim, GL_FLOAT, sizeof(PointSprite), base);
+	glColorPointer(4,GL_FLOAT,sizeof(PointSprite),(GLvoid*) (base + offsetof(PointSprite, color)));
 	
 	// Bind to the particles texture
 	glBindTexture(GL_TEXTURE_2D, (GLuint)textureData.textureID);
@@ -576,7 +2170,7 @@ void ofxParticleEmitter::drawPointsOES()
 	// Configure the point size pointer which will use the currently bound VBO.  PointSprite contains
 	// both the location of the point as well as its size, so the config below tells the point size
 	// pointer where in the currently bound VBO it can find the size for each point
-	glPointSizePointerOES(GL_FLOAT,sizeof(PointSprite),(GLvoid*) (sizeof(GL_FLOAT)*2));
+	glPointSizePointerOES(GL_FLOAT,sizeof(PointSprite),(GLvoid*) (base + offsetof(PointSprite, size)));
 	
 	// Change the blend function used if blendAdditive has been set
 	
@@ -608,4 +2202,11 @@ void ofxParticleEmitter::drawPointsOES()
 #endif
 }
 
+// ------------------------------------------------------------------------
+// Instantiations
+// ------------------------------------------------------------------------
 
+template class ParticleUpdateJob<2>;
+template class ParticleUpdateJob<3>;
+template class ParticleEmitter<2>;
+template class ParticleEmitter<3>;
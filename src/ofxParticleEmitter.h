@@ -26,25 +26,25 @@
 
 #include "ofMain.h"
 #include "ofxXmlSettings.h"
+#include "ofxParticleTypes.h"
+#include "ofxParticleEmitterConfig.h"
+#include "ofxParticleLoader.h"
+#include "ofxParticlePool.h"
+#include "ofxParticleKernels.h"
+#include "ofxParticleRandom.h"
+#include "ofxParticleThreadPool.h"
+#include "ofxParticleQuadBatch.h"
+#include "ofxParticleInstanceRenderer.h"
+#include "ofxParticleDepthSort.h"
+#include "ofxParticleBounds.h"
+#include "ofxParticleBudget.h"
+#include "ofxParticleTextureCache.h"
+#include "Poco/Timestamp.h"
 
 // ------------------------------------------------------------------------
 // Structures
 // ------------------------------------------------------------------------
 
-// Structure that defines the elements which make up a color
-typedef struct {
-	GLfloat red;
-	GLfloat green;
-	GLfloat blue;
-	GLfloat alpha;
-} Color4f;
-
-// Structure that defines a vector using x and y
-typedef struct {
-	GLfloat x;
-	GLfloat y;
-} Vector2f;
-
 // Particle type
 enum kParticleTypes 
 {
@@ -52,14 +52,40 @@ enum kParticleTypes
 	kParticleTypeRadial
 };
 
-// Structure that holds the location and size for each point sprite
-typedef struct 
+// Particle storage layout
+enum kParticleStorageModes
 {
-	GLfloat x;
-	GLfloat y;
-	GLfloat size;
-	Color4f color;
-} PointSprite;
+	kParticleStorageArray,		// One Particle structure per particle
+	kParticleStoragePool		// One column per field, see ParticlePool
+};
+
+// How the array storage mode reuses the slots of dead particles, picked from the settings
+enum kParticleAllocationModes
+{
+	kParticleAllocationCompact,	// The last particle is moved into the slot of each one that dies
+	kParticleAllocationRing		// The array is a ring and the oldest particles are retired by moving its head
+};
+
+// How the particles are drawn on desktop GL
+enum kParticleRenderModes
+{
+	kParticleRenderQuads,		// Quads expanded on the CPU, see ofxParticleQuadBatch
+	kParticleRenderInstanced	// One instance per particle expanded by a shader, quads when unsupported
+};
+
+// How pool particles are advanced
+enum kParticleEvaluationModes
+{
+	kParticleEvaluateStep,		// State integrated every update
+	kParticleEvaluateAnalytic	// State computed from spawn values and age, where the config allows
+};
+
+// Layout of the per particle vertex data handed to the renderer
+enum kParticleVertexFormats
+{
+	kParticleVertexFloat,		// PointSprite, full precision
+	kParticleVertexPacked		// PackedPointSprite, half float position and size with a byte color
+};
 
 // Structure used to hold particle specific information
 typedef struct 
@@ -78,8 +104,21 @@ typedef struct
 	GLfloat		particleSize;
 	GLfloat		particleSizeDelta;
 	GLfloat		timeToLive;
+	Vector2f	previousPosition;	// State before the last fixed step, for interpolation
+	GLfloat		previousSize;
 } Particle;
 
+// Values derived from the settings once per update rather than for every particle
+typedef struct
+{
+	int			features;					// kParticleFeatures the settings use
+	GLfloat		radiusDelta;				// maxRadius over particleLifespan
+	GLfloat		angle, angleVariance;		// In radians
+	GLfloat		rotatePerSecond, rotatePerSecondVariance;	// In radians
+	GLfloat		axisX, axisY;				// Unit vector angle points along
+	GLfloat		coneCos;					// Cosine of the half angle of the 3D launch cone
+} ParticleEmitterConstants;
+
 // ------------------------------------------------------------------------
 // Macros
 // ------------------------------------------------------------------------
@@ -90,16 +129,10 @@ typedef struct
 // Macro which returns a random number between 0 and 1
 #define RANDOM_0_TO_1() (ofRandom( 0.0f, 1.0f ))
 
-// Macro which converts degrees into radians
-#define DEGREES_TO_RADIANS(__ANGLE__) ((__ANGLE__) / 180.0 * PI)
-
 // ------------------------------------------------------------------------
 // Inline functions
 // ------------------------------------------------------------------------
 
-// Return a Color4f structure populated with 1.0's
-static const Color4f Color4fOnes = {1.0f, 1.0f, 1.0f, 1.0f};
-
 // Return a zero populated Vector2f
 static const Vector2f Vector2fZero = {0.0f, 0.0f};
 
@@ -109,12 +142,6 @@ static inline Vector2f Vector2fMake(GLfloat x, GLfloat y) {
 	return r;
 }
 
-// Return a Color4f structure populated with the color values passed in
-static inline Color4f Color4fMake(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
-	Color4f c; c.red = red; c.green = green; c.blue = blue; c.alpha = alpha;
-	return c;
-}
-
 // Return a Vector2f containing v multiplied by s
 static inline Vector2f Vector2fMultiply(Vector2f v, GLfloat s) {
 	Vector2f r; 
@@ -154,32 +181,221 @@ static inline Vector2f Vector2fNormalize(Vector2f v) {
 	return Vector2fMultiply(v, 1.0f/Vector2fLength(v));
 }
 
-#define MAXIMUM_UPDATE_RATE 30.0f	// The maximum number of updates that occur per frame
+#define MAXIMUM_STEPS_PER_UPDATE 8	// Fixed steps run by one update before time is dropped
+#define PARTICLE_PREWARM_STEP 0.0667f	// Longest step prewarm() takes where a particle cannot be solved directly
+#define PARTICLE_ANALYTIC_EPOCH 1024.0f	// Seconds after which analytic spawn times are rebased, to keep their precision
+#define PARTICLE_CHUNK_SIZE 2048	// Particles per work item of a parallel update, about 200KB of columns
+
+// ------------------------------------------------------------------------
+// Dimensions
+// ------------------------------------------------------------------------
+
+// Types and vector math ParticleEmitter is built on for a number of dimensions.  A 2D
+// emitter lives in the z = 0 plane, so its z reads as 0 and writing it does nothing.
+// The 3D version is in ofx3DParticleEmitter.h
+template <int Dim> struct ParticleDimension;
+
+template <>
+struct ParticleDimension<2>
+{
+	typedef Vector2f		Vector;
+	typedef ::Particle		Particle;
+	typedef ::PointSprite	PointSprite;
+	
+	enum { features = 0 };		// kParticleFeatures the pool kernels always need
+	
+	static inline Vector	zero()									{ return Vector2fZero; }
+	static inline Vector	make( GLfloat x, GLfloat y, GLfloat )	{ return Vector2fMake( x, y ); }
+	static inline GLfloat	getZ( const Vector& )					{ return 0.0f; }
+	static inline GLfloat	getZ( const PointSprite& )				{ return 0.0f; }
+	static inline void		setZ( Vector&, GLfloat )				{}
+	static inline void		setZ( PointSprite&, GLfloat )			{}
+	static inline bool		isZero( const Vector& v )				{ return !v.x && !v.y; }
+	static inline Vector	add( Vector v1, Vector v2 )				{ return Vector2fAdd( v1, v2 ); }
+	static inline Vector	sub( Vector v1, Vector v2 )				{ return Vector2fSub( v1, v2 ); }
+	static inline Vector	multiply( Vector v, GLfloat s )			{ return Vector2fMultiply( v, s ); }
+	static inline Vector	normalize( Vector v )					{ return Vector2fNormalize( v ); }
+	
+	// v rotated by 90 degrees about the z axis
+	static inline Vector	perpendicular( Vector v )				{ return Vector2fMake( -v.y, v.x ); }
+};
 
 // ------------------------------------------------------------------------
-// ofxParticleEmitter
+// ParticleEmitter
 // ------------------------------------------------------------------------
 
-class ofxParticleEmitter 
+template <int Dim> class ParticleEmitter;
+
+// Runs one stage of a parallel pool update on a chunk of PARTICLE_CHUNK_SIZE particles
+template <int Dim>
+class ParticleUpdateJob : public ofxParticleJob
 {
 	
 public:
 	
-	ofxParticleEmitter();
-	~ofxParticleEmitter();
+	enum { kRetire, kIntegrate, kWriteVertices, kEvaluate };
+	
+	ParticleUpdateJob( ParticleEmitter<Dim>* emitter, int stage, GLfloat value, int count );
+	void	run( int chunk );
+	
+protected:
+	
+	ParticleEmitter<Dim>*	emitter;
+	int					stage;
+	GLfloat				value;		// Time step, or the interpolation factor when writing vertices
+	int					count;		// Number of particles the chunks cover
+};
+
+// The emitter engine, written once for 2D and 3D.  Use it through ofxParticleEmitter or
+// ofx3DParticleEmitter, which are its two instantiations.  Everything the 2D emitter does
+// the 3D one does too, with these differences:
+//
+//   - 3D particles are launched within a cone around the direction angle points in, in
+//     the xy plane, whose half angle is angleVariance
+//   - Tangential acceleration turns 3D particles about the z axis
+//   - 3D vertices are always kParticleVertexFloat, and kParticleRenderQuads draws each
+//     sprite on its own
+template <int Dim>
+class ParticleEmitter 
+{
+	
+	friend class ParticleUpdateJob<Dim>;
+	friend class ofxParticleSystem;
+	friend class ParticleSystemUpdateJob;
+	template <class Emitter> friend class ofxParticleEmitterLoadRequest;
+	
+public:
+	
+	typedef ParticleDimension<Dim>			Dimension;
+	typedef typename Dimension::Vector		Vector;
+	typedef typename Dimension::Particle	Particle;
+	typedef typename Dimension::PointSprite	PointSprite;
+	
+	ParticleEmitter();
+	~ParticleEmitter();
 	
 	bool	loadFromXml( const std::string& filename );
 	void	update();
+	void	update( GLfloat aDelta );
 	void	draw( int x = 0, int y = 0 );
 	void	exit();
 
+	// Load on a background thread, through the shared loader by default.  Until the loader's
+	// update() swaps the new config in on the GL thread, an emitter which was already loaded
+	// keeps running with its last config, without hot reload
+	ofxParticleLoadHandle	loadFromXmlAsync( const std::string& filename, ofxParticleLoader* loader = NULL );
+	bool	isLoading();
+	
+	// Set the emitter up from an already parsed config, which is shared rather than copied
+	bool	loadFromConfig( const ofxParticleEmitterConfigPtr& aConfig );
+	ofxParticleEmitterConfigPtr	getConfig() const;
+	
+	// Switch to the config ofxParticleConfigCache holds for the file this emitter was loaded
+	// from when the cache has reloaded it, keeping the particles already alive.  update()
+	// does this first, so it only needs calling directly on the GL thread when the emitter
+	// is not updated there.  Returns true when the config changed
+	bool	checkForReload();
+	
+	// New emitter running the same config with the same storage, vertex, render, stream
+	// and threading settings, without parsing anything.  The caller owns it
+	ParticleEmitter*	clone() const;
+
+	// Must be called before loadFromXml()
+	void	setStorageMode( int mode );
+	int		getStorageMode() const;
+	
+	// One of kParticleAllocationModes.  Particles which all live as long die in the order
+	// they were born, so array storage uses a ring when particleLifespanVariance is zero
+	int		getAllocationMode() const;
+
+	// Must be called before loadFromXml().  Packed vertices are less than half the size to
+	// upload but only hold positions to about half a pixel 1000 pixels from the emitter.
+	// They are 2D only
+	void	setVertexFormat( int format );
+	int		getVertexFormat() const;
+
+	// Force the pool kernels to a specific kParticleKernelISAs value, false if unavailable
+	bool	setKernelISA( int isa );
+
+	// Spawn up to count particles in one pass and return how many were spawned.  emitBurst()
+	// spawns them around position instead of sourcePosition
+	int		emit( int count );
+	int		emitBurst( int count, const Vector& position );
+
+	// Bring the emitter to where it would be after running for seconds, so effects such as
+	// smoke do not start empty.  Only particles which would still be alive are created, each
+	// aged in one go where the config allows it and in PARTICLE_PREWARM_STEP steps otherwise
+	void	prewarm( GLfloat seconds );
+	
+	// Share a particle and update time budget with other emitters, see ofxParticleBudget.
+	// The emitter's cap and emission rate follow the part of maxParticles it is given, but
+	// never drop below one particle.  A higher priority, or a smaller distance from the
+	// viewer, keeps more of it.  NULL leaves the budget
+	void	setBudget( ofxParticleBudget* aBudget, GLfloat priority = 1.0f );
+	void	setBudgetDistance( GLfloat distance );
+	GLfloat	getBudgetScale() const;
+
+	// Run the simulation at a fixed number of updates per second, or pass 0 to step by the
+	// time between updates.  The vertices are interpolated between the last two fixed
+	// steps so the simulation can run slower than the display
+	void	setFixedTimestep( GLfloat updatesPerSecond );
+
+	// In pool storage mode, gravity configs without radial or tangential acceleration can
+	// keep only each particle's spawn values and compute where it is from its age.  The
+	// particles are then exact for any time step, so an emitter which is not updated for
+	// a while is still right when update() catches it up, and no fixed timestep is needed.
+	// Gravity applies to the whole life of every particle, so changing it moves them all.
+	// Other configs are stepped as usual
+	void	setEvaluationMode( int mode );
+	int		getEvaluationMode() const;
+	bool	isAnalytic() const;
+
+	// Split the pool update into chunks run across a thread pool, the shared one by
+	// default.  Only used in pool storage mode
+	void	setParallelUpdate( bool enabled, ofxParticleThreadPool* threads = NULL );
+
+	// How vertices are streamed to the GPU, one of kParticleStreamModes
+	void	setStreamMode( int mode );
+	
+	// One of kParticleRenderModes, instanced by default
+	void	setRenderMode( int mode );
+	int		getRenderMode() const;
+	
+	// One of kParticleDepthSortModes, off by default.  Sorted emitters draw their sprites
+	// back to front for the modelview matrix draw() is called with, so alpha blending
+	// layers them correctly.  3D only
+	void	setDepthSort( int mode );
+	int		getDepthSort() const;
+	
+	// Bytes of vertex data sent to the GPU by the last draw()
+	size_t	getBytesUploaded() const;
+	
+	// Box around the sprites written by the last update, their size included, in the
+	// coordinates draw() is given them in.  It is grown as the vertices are written, so
+	// costs no pass of its own.  Empty when no particles are alive
+	const ParticleBounds&	getBounds() const;
+	
+	// False when the emitter drawn at x, y would be wholly outside the rect, or the frustum
+	// from ofxParticleGetFrustum()
+	bool	isVisible( GLfloat left, GLfloat top, GLfloat width, GLfloat height, int x = 0, int y = 0 ) const;
+	bool	isVisible( const ParticleFrustum& frustum, int x = 0, int y = 0 ) const;
+	
+	// Draw from part of another texture, such as an atlas page, instead of the whole sprite
+	void	setTextureRegion( const ofTextureData& texData, const ParticleTexRect& rect );
+	
+	// Sprite image loaded from the config, shared through ofxParticleTextureCache
+	ofImage*	getTexture() const;
+	
+	// Restart the random stream used to spawn particles, so the emitter can be reproduced exactly
+	void	seedRandom( unsigned int seed );
+
 	int				emitterType;
-	Vector2f		sourcePosition, sourcePositionVariance;			
+	Vector			sourcePosition, sourcePositionVariance;			
 	GLfloat			angle, angleVariance;								
 	GLfloat			speed, speedVariance;	
 	GLfloat			radialAcceleration, tangentialAcceleration;
 	GLfloat			radialAccelVariance, tangentialAccelVariance;
-	Vector2f		gravity;	
+	Vector			gravity;	
 	GLfloat			particleLifespan, particleLifespanVariance;			
 	Color4f			startColor, startColorVariance;						
 	Color4f			finishColor, finishColorVariance;
@@ -203,33 +419,116 @@ protected:
 	
     void    init();
 
-	void	parseParticleConfig();
+	void	applyConfig();
+	void	applyTexture( const ofxParticlePixelsPtr& filePixels = ofxParticlePixelsPtr() );
+	void	updateConstants();
 	void	setupArrays();
+	void	createBuffers();
+	void	reloadConfig( const ofxParticleEmitterConfigPtr& aConfig );
+	void	resizeArrays();
+	
+	// Asynchronous loading, see ofxParticleEmitterLoadRequest
+	bool	finishLoad( int step, const ofxParticleEmitterConfigPtr& aConfig, const ofxParticlePixelsPtr& filePixels );
+	void	cancelLoad();
 	
 	void	stopParticleEmitter();
 	bool	addParticle();
+	int		spawnParticles( int count, const Vector& position );	// emitBurst() without updateConstants()
+	int		particleSlot( int index ) const;
+	void	linearizeParticles();
 	void	initParticle( Particle* particle );
+	void	storeParticle( int index, const Particle* particle );
+	void	storeVertex( int index, const Vector& position, GLfloat size, const Color4f& color );
+	int		emitPool( int count, const Vector& origin );
+	
+	void	advance( GLfloat aDelta );
+	void	simulate( GLfloat aDelta );
+	int		particleCap() const;
+	void	step( GLfloat aDelta );
+	bool	updateParticle( Particle* particle, GLfloat aDelta );
+	template <int Features> void	stepParticles( GLfloat aDelta );
+	template <int Features> bool	integrateParticle( Particle* particle, GLfloat aDelta );
+	bool	prewarmParticle( Particle* particle, GLfloat age, bool solve );
+	void	updatePool( GLfloat aDelta );
+	int		retireRange( int begin, int end, GLfloat aDelta );
+	void	integrateRange( int begin, int end, GLfloat aDelta );
+	void	storePreviousState();
+	void	toAnalytic();
+	void	fromAnalytic();
+	void	stepAnalytic( GLfloat aDelta );
+	void	sliceAnalytic( GLfloat aDelta );
+	void	evaluate();
+	void	evaluateRange( int begin, int end, ParticleBounds& rangeBounds );
+	void	writeVertices( GLfloat alpha );
+	void	writeVerticesRange( int begin, int end, GLfloat alpha, ParticleBounds& rangeBounds );
+	void	mergeChunkBounds( int chunks );
 	
 	void	drawTextures();
-	void	drawPoints();
+	bool	drawInstanced();
+	void	appendQuads( ofxParticleQuadBatch& batch, int x, int y );
 	void	drawPointsOES();
+	void	sortByDepth();
+	const PointSprite*	getSortedVertices();
+	
+	// Array storage updates specialized on kParticleFeatures, see updateConstants().  The
+	// depth feature comes from Dim rather than the settings, so it has no entries here
+	typedef void (ParticleEmitter::*StepParticlesFunction)( GLfloat );
+	typedef bool (ParticleEmitter::*UpdateParticleFunction)( Particle*, GLfloat );
+	static const StepParticlesFunction	stepParticlesTable[kParticleFeatureDepth];
+	static const UpdateParticleFunction	updateParticleTable[kParticleFeatureDepth];
 	
-	ofxXmlSettings*	settings;
+	ofxParticleEmitterConfigPtr	config;	// Parsed settings the emitter was loaded from
+	ofxParticleLoadHandle		loadRequest;	// Background load in progress, if any
+	std::string		configFilename;		// File the config is cached under, empty when loaded from a config
+	int				configGeneration;	// ofxParticleConfigCache generation the config was checked against
 
 	ofImage*		texture;												
 	ofTextureData	textureData;
+	ParticleTexRect	texRect;		// Part of textureData the sprite covers
 	
 	GLfloat			emissionRate;
 	GLfloat			emitCounter;	
 	GLfloat			elapsedTime;
-	int				lastUpdateMillis;
+	Poco::Timestamp	lastUpdate;		// When update() was last called
+	GLfloat			fixedTimestep;	// Seconds per simulation step, 0 when stepping by frame time
+	GLfloat			accumulator;	// Time passed which has not been simulated yet
 
 	bool			active, useTexture;
 	GLint			particleIndex;	// Stores the number of particles that are going to be rendered
 
-	GLuint			verticesID;		// Holds the buffer name of the VBO that stores the color and vertices info for the particles
+	ofxParticleStreamBuffer	vertexStream;	// VBO the particle vertices are streamed through every draw
 	Particle*		particles;		// Array of particles that hold the particle emitters particle details
+	int				allocationMode;	// One of kParticleAllocationModes
+	GLint			particleHead;	// Slot of the oldest particle in particles, only moved by the ring allocation mode
 	PointSprite*	vertices;		// Array of vertices and color information for each particle to be rendered
+	PackedPointSprite*	packedVertices;	// Used in place of vertices when vertexFormat is kParticleVertexPacked
+	Vector			packedOrigin;	// Position packed vertices are relative to
+	ParticleBounds	bounds;			// Box around the vertices, see getBounds()
+	int				vertexFormat;	// One of kParticleVertexFormats
+	ofxParticleQuadBatch	quadBatch;	// Quads expanded from vertices and drawn with one call
+	int				renderMode;		// One of kParticleRenderModes
+	ofxParticleDepthSort	depthSort;	// Back to front order of the vertices, see setDepthSort()
+	std::vector<PointSprite>	sortedVertices;	// Vertices gathered in depth order for draws which follow the array order
+
+	int				storageMode;	// One of kParticleStorageModes
+	ParticlePool	pool;			// Column storage used in place of particles when storageMode is kParticleStoragePool
+	const ParticleKernels*	kernels;	// Integration kernels used to update the pool
+	ParticleEmitterConstants	constants;	// Derived from the settings by updateConstants()
+	int				evaluationMode;	// One of kParticleEvaluationModes
+	bool			analyticState;	// The pool holds spawn values rather than the current state
+	GLfloat			analyticClock;	// Emitter time the spawn and death times are measured in
+
+	ofxParticleRandom	rng;		// Random stream used when initializing particles
+
+	ofxParticleThreadPool*	threadPool;		// Threads used to update the pool, NULL to update on the calling thread
+	std::vector<GLint>		chunkSurvivors;	// Particles left in each chunk after retiring the dead ones
+	std::vector<ParticleBounds>	chunkBounds;	// Box around the vertices each chunk wrote
+	
+	ofxParticleBudget*	budget;			// Budget the emitter takes part in, if any
+	ParticleBudgetEntry	budgetEntry;	// This emitter's part of it
 };
 
+// The 2D emitter
+typedef ParticleEmitter<2> ofxParticleEmitter;
+
 #endif
\ No newline at end of file
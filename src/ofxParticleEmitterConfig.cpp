@@ -0,0 +1,356 @@
+//
+// ofxParticleEmitterConfig.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "ofxParticleEmitterConfig.h"
+#include "ofxParticleBinaryConfig.h"
+#include "Poco/File.h"
+
+// ------------------------------------------------------------------------
+// ofxParticleEmitterConfig
+// ------------------------------------------------------------------------
+
+ofxParticleEmitterConfig::ofxParticleEmitterConfig()
+{
+	// Values used for anything a file leaves out, as the emitters have always defaulted to
+	texturePixels = NULL;
+	textureWidth = textureHeight = textureChannels = 0;
+	
+	emitterType = 0;
+	sourcePosition.x = sourcePosition.y = sourcePosition.z = 0.0f;
+	angle = angleVariance = 0.0f;
+	speed = speedVariance = 0.0f;
+	radialAcceleration = tangentialAcceleration = 0.0f;
+	gravity.x = gravity.y = gravity.z = 0.0f;
+	particleLifespan = particleLifespanVariance = 0.0f;
+	startColor.red = startColor.green = startColor.blue = startColor.alpha = 1.0f;
+	startColorVariance.red = startColorVariance.green = startColorVariance.blue = startColorVariance.alpha = 1.0f;
+	finishColor.red = finishColor.green = finishColor.blue = finishColor.alpha = 1.0f;
+	finishColorVariance.red = finishColorVariance.green = finishColorVariance.blue = finishColorVariance.alpha = 1.0f;
+	startParticleSize = startParticleSizeVariance = 0.0f;
+	finishParticleSize = finishParticleSizeVariance = 0.0f;
+	maxParticles = 0;
+	duration = -1;
+	blendFuncSource = blendFuncDestination = 0;
+	maxRadius = maxRadiusVariance = radiusSpeed = minRadius = 0.0f;
+	rotatePerSecond = rotatePerSecondVariance = 0.0f;
+}
+
+ofxParticleEmitterConfigPtr ofxParticleEmitterConfig::load( const std::string& filename )
+{
+	std::string path = ofToDataPath( filename );
+	
+	if ( ofxParticleBinaryConfig::isBinary( path ) )
+		return ofxParticleBinaryConfig::load( path );
+	
+	// A compiled copy older than the .pex is out of date and skipped
+	Poco::File source( path );
+	Poco::File compiled( ofxParticleBinaryConfig::getCompiledName( path ) );
+	
+	if ( compiled.exists() && ( !source.exists() || source.getLastModified() <= compiled.getLastModified() ) )
+	{
+		ofxParticleEmitterConfigPtr config = ofxParticleBinaryConfig::load( compiled.path() );
+		if ( !config.isNull() )
+			return config;
+		
+		ofLog( OF_LOG_WARNING, "ofxParticleEmitterConfig::load() - falling back to " + filename );
+	}
+	
+	return loadFromXml( filename );
+}
+
+ofxParticleEmitterConfigPtr ofxParticleEmitterConfig::loadFromXml( const std::string& filename )
+{
+	ofxXmlSettings settings;
+	if ( !settings.loadFile( filename ) )
+	{
+		ofLog( OF_LOG_ERROR, "ofxParticleEmitterConfig::loadFromXml() - unable to load " + filename );
+		return ofxParticleEmitterConfigPtr();
+	}
+	
+	ofxParticleEmitterConfig* config = new ofxParticleEmitterConfig();
+	config->filename = filename;
+	config->parse( settings );
+	
+	return ofxParticleEmitterConfigPtr( config );
+}
+
+void ofxParticleEmitterConfig::parse( ofxXmlSettings& settings )
+{
+	settings.pushTag( "particleEmitterConfig" );
+	
+	textureName					= settings.getAttribute( "texture", "name", "" );
+	textureData					= settings.getAttribute( "texture", "data", "" );
+	
+	// Embedded images are used ahead of the file, so self-contained configs open nothing else
+	if ( textureData != "" )
+	{
+		decoded = ofxParticleImageDecoder::getShared().decode( textureData );
+		if ( !decoded.isNull() )
+		{
+			texturePixels	= &decoded->pixels[0];
+			textureWidth	= decoded->width;
+			textureHeight	= decoded->height;
+			textureChannels	= decoded->channels;
+		}
+		else
+		{
+			ofLog( OF_LOG_ERROR, "ofxParticleEmitterConfig::parse() - unable to decode the embedded image in " + filename );
+		}
+	}
+	
+	emitterType					= settings.getAttribute( "emitterType", "value", emitterType );
+	
+	sourcePosition.x			= settings.getAttribute( "sourcePosition", "x", sourcePosition.x );
+	sourcePosition.y			= settings.getAttribute( "sourcePosition", "y", sourcePosition.y );
+	sourcePosition.z			= settings.getAttribute( "sourcePosition", "z", sourcePosition.z );
+	
+	speed						= settings.getAttribute( "speed", "value", speed );
+	speedVariance				= settings.getAttribute( "speedVariance", "value", speedVariance );
+	particleLifespan			= settings.getAttribute( "particleLifespan", "value", particleLifespan );
+	particleLifespanVariance	= settings.getAttribute( "particleLifespanVariance", "value", particleLifespanVariance );
+	angle						= settings.getAttribute( "angle", "value", angle );
+	angleVariance				= settings.getAttribute( "angleVariance", "value", angleVariance );
+	
+	gravity.x					= settings.getAttribute( "gravity", "x", gravity.x );
+	gravity.y					= settings.getAttribute( "gravity", "y", gravity.y );
+	gravity.z					= settings.getAttribute( "gravity", "z", gravity.z );
+	
+	radialAcceleration			= settings.getAttribute( "radialAcceleration", "value", radialAcceleration );
+	tangentialAcceleration		= settings.getAttribute( "tangentialAcceleration", "value", tangentialAcceleration );
+	
+	startColor.red				= settings.getAttribute( "startColor", "red", startColor.red );
+	startColor.green			= settings.getAttribute( "startColor", "green", startColor.green );
+	startColor.blue				= settings.getAttribute( "startColor", "blue", startColor.blue );
+	startColor.alpha			= settings.getAttribute( "startColor", "alpha", startColor.alpha );
+	
+	startColorVariance.red		= settings.getAttribute( "startColorVariance", "red", startColorVariance.red );
+	startColorVariance.green	= settings.getAttribute( "startColorVariance", "green", startColorVariance.green );
+	startColorVariance.blue		= settings.getAttribute( "startColorVariance", "blue", startColorVariance.blue );
+	startColorVariance.alpha	= settings.getAttribute( "startColorVariance", "alpha", startColorVariance.alpha );
+	
+	finishColor.red				= settings.getAttribute( "finishColor", "red", finishColor.red );
+	finishColor.green			= settings.getAttribute( "finishColor", "green", finishColor.green );
+	finishColor.blue			= settings.getAttribute( "finishColor", "blue", finishColor.blue );
+	finishColor.alpha			= settings.getAttribute( "finishColor", "alpha", finishColor.alpha );
+	
+	finishColorVariance.red		= settings.getAttribute( "finishColorVariance", "red", finishColorVariance.red );
+	finishColorVariance.green	= settings.getAttribute( "finishColorVariance", "green", finishColorVariance.green );
+	finishColorVariance.blue	= settings.getAttribute( "finishColorVariance", "blue", finishColorVariance.blue );
+	finishColorVariance.alpha	= settings.getAttribute( "finishColorVariance", "alpha", finishColorVariance.alpha );
+	
+	maxParticles				= settings.getAttribute( "maxParticles", "value", maxParticles );
+	startParticleSize			= settings.getAttribute( "startParticleSize", "value", startParticleSize );
+	startParticleSizeVariance	= settings.getAttribute( "startParticleSizeVariance", "value", startParticleSizeVariance );
+	finishParticleSize			= settings.getAttribute( "finishParticleSize", "value", finishParticleSize );
+	finishParticleSizeVariance	= settings.getAttribute( "finishParticleSizeVariance", "value", finishParticleSizeVariance );
+	duration					= settings.getAttribute( "duration", "value", duration );
+	blendFuncSource				= settings.getAttribute( "blendFuncSource", "value", blendFuncSource );
+	blendFuncDestination		= settings.getAttribute( "blendFuncDestination", "value", blendFuncDestination );
+	
+	maxRadius					= settings.getAttribute( "maxRadius", "value", maxRadius );
+	maxRadiusVariance			= settings.getAttribute( "maxRadiusVariance", "value", maxRadiusVariance );
+	radiusSpeed					= settings.getAttribute( "radiusSpeed", "value", radiusSpeed );
+	minRadius					= settings.getAttribute( "minRadius", "value", minRadius );
+	
+	rotatePerSecond				= settings.getAttribute( "rotatePerSecond", "value", rotatePerSecond );
+	rotatePerSecondVariance		= settings.getAttribute( "rotatePerSecondVariance", "value", rotatePerSecondVariance );
+	
+	settings.popTag();
+}
+
+// ------------------------------------------------------------------------
+// ofxParticleConfigCache
+// ------------------------------------------------------------------------
+
+ofxParticleConfigCache::ofxParticleConfigCache()
+{
+	generation = 0;
+	watchInterval = PARTICLE_HOT_RELOAD_INTERVAL;
+	watching = false;
+}
+
+ofxParticleConfigCache::~ofxParticleConfigCache()
+{
+	setHotReload( false );
+}
+
+ofxParticleConfigCache& ofxParticleConfigCache::getShared()
+{
+	static ofxParticleConfigCache shared;
+	return shared;
+}
+
+ofxParticleEmitterConfigPtr ofxParticleConfigCache::load( const std::string& filename )
+{
+	{
+		Poco::FastMutex::ScopedLock lock( mutex );
+		
+		std::map<std::string, Entry>::iterator it = configs.find( filename );
+		if ( it != configs.end() )
+			return it->second.config;
+	}
+	
+	// Load without holding the lock so other files can load at the same time.  Two threads
+	// asking for the same new file both load it and the first one stored wins.  The times
+	// are taken first so a file saved while it is parsed is seen as changed
+	Entry entry;
+	getModified( filename, entry.sourceModified, entry.compiledModified );
+	
+	entry.config = ofxParticleEmitterConfig::load( filename );
+	if ( entry.config.isNull() )
+		return entry.config;
+	
+	Poco::FastMutex::ScopedLock lock( mutex );
+	
+	std::map<std::string, Entry>::iterator it = configs.find( filename );
+	if ( it != configs.end() )
+		return it->second.config;
+	
+	configs[filename] = entry;
+	return entry.config;
+}
+
+ofxParticleEmitterConfigPtr ofxParticleConfigCache::find( const std::string& filename )
+{
+	Poco::FastMutex::ScopedLock lock( mutex );
+	
+	std::map<std::string, Entry>::iterator it = configs.find( filename );
+	return it != configs.end() ? it->second.config : ofxParticleEmitterConfigPtr();
+}
+
+void ofxParticleConfigCache::invalidate( const std::string& filename )
+{
+	Poco::FastMutex::ScopedLock lock( mutex );
+	configs.erase( filename );
+}
+
+void ofxParticleConfigCache::clear()
+{
+	Poco::FastMutex::ScopedLock lock( mutex );
+	configs.clear();
+}
+
+// ------------------------------------------------------------------------
+// Hot reload
+// ------------------------------------------------------------------------
+
+void ofxParticleConfigCache::getModified( const std::string& filename, Poco::Timestamp& source, Poco::Timestamp& compiled )
+{
+	std::string path = ofToDataPath( filename );
+	Poco::File sourceFile( path );
+	Poco::File compiledFile( ofxParticleBinaryConfig::getCompiledName( path ) );
+	
+	// A missing file counts as the epoch, so deleting a compiled config is a change too
+	source = sourceFile.exists() ? sourceFile.getLastModified() : Poco::Timestamp( 0 );
+	compiled = compiledFile.exists() ? compiledFile.getLastModified() : Poco::Timestamp( 0 );
+}
+
+int ofxParticleConfigCache::reloadChanged()
+{
+	// Snapshot the times so the files are checked and parsed without holding the lock
+	std::vector<std::string> names;
+	std::vector<Entry> entries;
+	{
+		Poco::FastMutex::ScopedLock lock( mutex );
+		
+		for ( std::map<std::string, Entry>::iterator it = configs.begin(); it != configs.end(); ++it )
+		{
+			names.push_back( it->first );
+			entries.push_back( it->second );
+		}
+	}
+	
+	int reloaded = 0;
+	
+	for ( size_t i = 0; i < names.size(); i++ )
+	{
+		Entry entry;
+		getModified( names[i], entry.sourceModified, entry.compiledModified );
+		
+		if ( entry.sourceModified == entries[i].sourceModified && entry.compiledModified == entries[i].compiledModified )
+			continue;
+		
+		entry.config = ofxParticleEmitterConfig::load( names[i] );
+		
+		Poco::FastMutex::ScopedLock lock( mutex );
+		
+		// Skip files invalidated or reloaded by someone else in the meantime
+		std::map<std::string, Entry>::iterator it = configs.find( names[i] );
+		if ( it == configs.end() || it->second.config != entries[i].config )
+			continue;
+		
+		if ( entry.config.isNull() )
+		{
+			ofLog( OF_LOG_WARNING, "ofxParticleConfigCache::reloadChanged() - keeping the last good config for " + names[i] );
+			it->second.sourceModified = entry.sourceModified;
+			it->second.compiledModified = entry.compiledModified;
+			continue;
+		}
+		
+		it->second = entry;
+		generation++;
+		reloaded++;
+	}
+	
+	return reloaded;
+}
+
+void ofxParticleConfigCache::setHotReload( bool enabled, GLfloat interval )
+{
+	watchInterval = interval;
+	
+	if ( enabled == watching )
+		return;
+	
+	if ( enabled )
+	{
+		watchStop.reset();
+		watching = true;
+		watchThread.start( *this );
+	}
+	else
+	{
+		watchStop.set();
+		watchThread.join();
+		watching = false;
+	}
+}
+
+bool ofxParticleConfigCache::isHotReloading() const
+{
+	return watching;
+}
+
+int ofxParticleConfigCache::getGeneration() const
+{
+	// Read without the lock, an emitter seeing the change a frame late does not matter
+	return generation;
+}
+
+void ofxParticleConfigCache::run()
+{
+	// Waiting on the event rather than sleeping lets setHotReload( false ) return at once
+	while ( !watchStop.tryWait( (long)( watchInterval * 1000.0f ) ) )
+		reloadChanged();
+}
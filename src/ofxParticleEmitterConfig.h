@@ -0,0 +1,166 @@
+//
+// ofxParticleEmitterConfig.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef _OFX_PARTICLE_EMITTER_CONFIG
+#define _OFX_PARTICLE_EMITTER_CONFIG
+
+#include "ofMain.h"
+#include "ofxXmlSettings.h"
+#include "ofxParticleTypes.h"
+#include "ofxParticleMappedFile.h"
+#include "ofxParticleImageDecoder.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/Mutex.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Thread.h"
+#include "Poco/Event.h"
+#include "Poco/Runnable.h"
+
+#define PARTICLE_HOT_RELOAD_INTERVAL	0.5f	// Seconds between checks for changed files
+
+class ofxParticleEmitterConfig;
+
+// Configs are only ever handed out as const, so one parsed config can back any number of
+// emitters on any thread
+typedef Poco::SharedPtr<const ofxParticleEmitterConfig> ofxParticleEmitterConfigPtr;
+
+// ------------------------------------------------------------------------
+// ofxParticleEmitterConfig
+// ------------------------------------------------------------------------
+
+// The settings of a .pex file, parsed once.  Emitters copy these into their own members
+// when they are created, so changing an emitter at run time never touches the config.
+// Vectors carry a z component for ofx3DParticleEmitter, 2D emitters ignore it
+class ofxParticleEmitterConfig
+{
+	
+public:
+	
+	ofxParticleEmitterConfig();
+	
+	// Load a config in either format.  A compiled config is used in place of a .pex file
+	// when one sits next to it and is not older, and the .pex is parsed otherwise
+	static ofxParticleEmitterConfigPtr	load( const std::string& filename );
+	
+	// Parse a .pex file, returns a null pointer when it cannot be read
+	static ofxParticleEmitterConfigPtr	loadFromXml( const std::string& filename );
+	
+	// Parse the particleEmitterConfig tag of already loaded settings
+	void	parse( ofxXmlSettings& settings );
+	
+	std::string		filename;						// File the config was loaded from
+	std::string		textureName;					// Sprite image file, empty when the image is embedded
+	std::string		textureData;					// Embedded sprite image, empty when it is a file
+	
+	// Sprite pixels embedded in the config, NULL when the image is a file.  They are read in
+	// place from a compiled config, or decoded from textureData
+	const unsigned char*	texturePixels;
+	int						textureWidth, textureHeight, textureChannels;
+	Poco::SharedPtr<ofxParticleMappedFile>	mapping;	// Keeps compiled pixels mapped
+	ofxParticlePixelsPtr					decoded;	// Keeps decoded pixels alive
+	
+	int				emitterType;
+	Vector3f		sourcePosition;
+	GLfloat			angle, angleVariance;
+	GLfloat			speed, speedVariance;
+	GLfloat			radialAcceleration, tangentialAcceleration;
+	Vector3f		gravity;
+	GLfloat			particleLifespan, particleLifespanVariance;
+	Color4f			startColor, startColorVariance;
+	Color4f			finishColor, finishColorVariance;
+	GLfloat			startParticleSize, startParticleSizeVariance;
+	GLfloat			finishParticleSize, finishParticleSizeVariance;
+	GLint			maxParticles;
+	GLfloat			duration;
+	int				blendFuncSource, blendFuncDestination;
+	
+	GLfloat			maxRadius, maxRadiusVariance;
+	GLfloat			radiusSpeed;
+	GLfloat			minRadius;
+	GLfloat			rotatePerSecond, rotatePerSecondVariance;
+};
+
+// ------------------------------------------------------------------------
+// ofxParticleConfigCache
+// ------------------------------------------------------------------------
+
+// Loaded configs by file, so loading the same effect many times reads it once
+class ofxParticleConfigCache : public Poco::Runnable
+{
+	
+public:
+	
+	ofxParticleConfigCache();
+	~ofxParticleConfigCache();
+	
+	static ofxParticleConfigCache&	getShared();
+	
+	// Return the config for filename, loading it the first time.  Null when it cannot be read
+	ofxParticleEmitterConfigPtr	load( const std::string& filename );
+	
+	// Return the config currently cached for filename without loading it
+	ofxParticleEmitterConfigPtr	find( const std::string& filename );
+	
+	// Forget a file so the next load() parses it again.  Emitters keep the config they have
+	void	invalidate( const std::string& filename );
+	void	clear();
+	
+	// Parse again every cached file whose .pex or compiled config changed on disk since it
+	// was loaded, and return how many were replaced.  A file which fails to parse, such as
+	// one still being written, keeps its old config until it changes again
+	int		reloadChanged();
+	
+	// Call reloadChanged() from a background thread every interval seconds.  Emitters pick
+	// the new configs up at the start of their next update()
+	void	setHotReload( bool enabled, GLfloat interval = PARTICLE_HOT_RELOAD_INTERVAL );
+	bool	isHotReloading() const;
+	
+	// Incremented whenever a config is replaced, so emitters only have to look their file
+	// up again once something changed
+	int		getGeneration() const;
+	
+	void	run();
+	
+protected:
+	
+	struct Entry
+	{
+		ofxParticleEmitterConfigPtr	config;
+		Poco::Timestamp				sourceModified;		// .pex file, when there is one
+		Poco::Timestamp				compiledModified;	// Compiled config, when there is one
+	};
+	
+	static void	getModified( const std::string& filename, Poco::Timestamp& source, Poco::Timestamp& compiled );
+	
+	std::map<std::string, Entry>	configs;
+	Poco::FastMutex					mutex;
+	volatile int					generation;
+	
+	Poco::Thread	watchThread;
+	Poco::Event		watchStop;
+	GLfloat			watchInterval;
+	bool			watching;
+};
+
+#endif
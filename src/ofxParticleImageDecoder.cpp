@@ -0,0 +1,266 @@
+//
+// ofxParticleImageDecoder.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "ofxParticleImageDecoder.h"
+#include "ofxParticleTextureCache.h"
+#include "FreeImage.h"
+#include "Poco/InflatingStream.h"
+#include "Poco/Exception.h"
+#include <fstream>
+#include <sstream>
+
+// Value of each base64 character, -1 for anything which is skipped such as line breaks
+// and the padding at the end
+static const signed char base64Values[256] =
+{
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+	52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+	-1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+	15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+	-1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+	41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+static Poco::FastMutex	freeImageMutex;
+static bool				freeImageInitialized = false;
+
+// ------------------------------------------------------------------------
+// Cache
+// ------------------------------------------------------------------------
+
+ofxParticleImageDecoder& ofxParticleImageDecoder::getShared()
+{
+	static ofxParticleImageDecoder shared;
+	return shared;
+}
+
+ofxParticlePixelsPtr ofxParticleImageDecoder::decode( const std::string& data )
+{
+	unsigned long long key = ofxParticleTextureCache::hash( data.data(), data.size() );
+	
+	{
+		Poco::FastMutex::ScopedLock lock( mutex );
+		
+		std::map<unsigned long long, ofxParticlePixelsPtr>::iterator it = images.find( key );
+		if ( it != images.end() )
+			return it->second;
+	}
+	
+	// Decode without holding the lock so configs can load on several threads at once
+	std::vector<unsigned char> file;
+	ofxParticlePixels* decoded = new ofxParticlePixels();
+	
+	if ( !inflateBase64( data, file ) || file.empty() || !decodeImage( &file[0], file.size(), *decoded ) )
+	{
+		delete decoded;
+		return ofxParticlePixelsPtr();
+	}
+	
+	return store( key, decoded );
+}
+
+ofxParticlePixelsPtr ofxParticleImageDecoder::decodeFile( const std::string& path )
+{
+	std::ifstream stream( path.c_str(), std::ios::in | std::ios::binary );
+	if ( !stream )
+		return ofxParticlePixelsPtr();
+	
+	std::vector<unsigned char> file( ( std::istreambuf_iterator<char>( stream ) ), std::istreambuf_iterator<char>() );
+	if ( file.empty() )
+		return ofxParticlePixelsPtr();
+	
+	unsigned long long key = ofxParticleTextureCache::hash( &file[0], file.size() );
+	
+	{
+		Poco::FastMutex::ScopedLock lock( mutex );
+		
+		std::map<unsigned long long, ofxParticlePixelsPtr>::iterator it = images.find( key );
+		if ( it != images.end() )
+			return it->second;
+	}
+	
+	ofxParticlePixels* decoded = new ofxParticlePixels();
+	if ( !decodeImage( &file[0], file.size(), *decoded ) )
+	{
+		delete decoded;
+		return ofxParticlePixelsPtr();
+	}
+	
+	return store( key, decoded );
+}
+
+ofxParticlePixelsPtr ofxParticleImageDecoder::store( unsigned long long key, ofxParticlePixels* pixels )
+{
+	ofxParticlePixelsPtr stored( pixels );
+	
+	Poco::FastMutex::ScopedLock lock( mutex );
+	
+	// Another thread may have decoded the same image meanwhile, in which case theirs is kept
+	std::map<unsigned long long, ofxParticlePixelsPtr>::iterator it = images.find( key );
+	if ( it != images.end() )
+		return it->second;
+	
+	images[key] = stored;
+	return stored;
+}
+
+void ofxParticleImageDecoder::clear()
+{
+	Poco::FastMutex::ScopedLock lock( mutex );
+	images.clear();
+}
+
+int ofxParticleImageDecoder::getImageCount()
+{
+	Poco::FastMutex::ScopedLock lock( mutex );
+	return (int)images.size();
+}
+
+// ------------------------------------------------------------------------
+// Decoding
+// ------------------------------------------------------------------------
+
+bool ofxParticleImageDecoder::inflateBase64( const std::string& data, std::vector<unsigned char>& out )
+{
+	// Decode the base64 text, the compressed image is a fraction of its size
+	std::string file;
+	file.reserve( data.size() / 4 * 3 );
+	
+	unsigned int bits = 0;
+	int bitCount = 0;
+	for ( size_t i = 0; i < data.size(); i++ )
+	{
+		int value = base64Values[(unsigned char)data[i]];
+		if ( value < 0 )
+			continue;
+		
+		bits = ( ( bits << 6 ) | value ) & 0xffffff;
+		bitCount += 6;
+		if ( bitCount >= 8 )
+		{
+			bitCount -= 8;
+			file += (char)( bits >> bitCount );
+		}
+	}
+	
+	if ( file.empty() )
+		return false;
+	
+	// Particle Designer gzips the image, but take zlib streams and plain files as well
+	const unsigned char* header = (const unsigned char*)file.data();
+	bool gzip = file.size() >= 2 && header[0] == 0x1f && header[1] == 0x8b;
+	bool zlib = file.size() >= 2 && ( header[0] & 0x0f ) == 8 && ( ( header[0] << 8 ) | header[1] ) % 31 == 0;
+	
+	if ( !gzip && !zlib )
+	{
+		out.insert( out.end(), header, header + file.size() );
+		return true;
+	}
+	
+	// zlib comes with PocoFoundation, which every openFrameworks project links already
+	std::istringstream compressed( file );
+	Poco::InflatingInputStream inflater( compressed, gzip ? Poco::InflatingStreamBuf::STREAM_GZIP : Poco::InflatingStreamBuf::STREAM_ZLIB );
+	
+	// Compressed images usually grow by 2 to 4 times
+	out.reserve( out.size() + file.size() * 4 );
+	
+	try
+	{
+		char chunk[PARTICLE_DECODE_CHUNK];
+		while ( inflater.read( chunk, sizeof( chunk ) ) || inflater.gcount() > 0 )
+			out.insert( out.end(), chunk, chunk + inflater.gcount() );
+	}
+	catch ( Poco::Exception& )
+	{
+		return false;
+	}
+	
+	return !inflater.bad();
+}
+
+bool ofxParticleImageDecoder::decodeImage( const unsigned char* file, size_t size, ofxParticlePixels& out )
+{
+	// openFrameworks only initializes FreeImage when the first ofImage is created, which may
+	// not have happened yet.  FreeImage counts initializations, so a second one is harmless
+	{
+		Poco::FastMutex::ScopedLock lock( freeImageMutex );
+		if ( !freeImageInitialized )
+		{
+			FreeImage_Initialise();
+			freeImageInitialized = true;
+		}
+	}
+	
+	FIMEMORY* memory = FreeImage_OpenMemory( (BYTE*)file, (DWORD)size );
+	FREE_IMAGE_FORMAT format = FreeImage_GetFileTypeFromMemory( memory, 0 );
+	
+	FIBITMAP* bitmap = NULL;
+	if ( format != FIF_UNKNOWN && FreeImage_FIFSupportsReading( format ) )
+		bitmap = FreeImage_LoadFromMemory( format, memory, 0 );
+	
+	FreeImage_CloseMemory( memory );
+	
+	if ( bitmap == NULL )
+		return false;
+	
+	FIBITMAP* converted = FreeImage_ConvertTo32Bits( bitmap );
+	FreeImage_Unload( bitmap );
+	
+	if ( converted == NULL )
+		return false;
+	
+	out.width = FreeImage_GetWidth( converted );
+	out.height = FreeImage_GetHeight( converted );
+	out.channels = 4;
+	out.pixels.resize( out.width * out.height * 4 );
+	
+	// FreeImage stores rows from the bottom, in the byte order of the platform
+	for ( int y = 0; y < out.height; y++ )
+	{
+		const BYTE* source = FreeImage_GetScanLine( converted, out.height - 1 - y );
+		unsigned char* destination = &out.pixels[y * out.width * 4];
+		
+		for ( int x = 0; x < out.width; x++, source += 4, destination += 4 )
+		{
+			destination[0] = source[FI_RGBA_RED];
+			destination[1] = source[FI_RGBA_GREEN];
+			destination[2] = source[FI_RGBA_BLUE];
+			destination[3] = source[FI_RGBA_ALPHA];
+		}
+	}
+	
+	FreeImage_Unload( converted );
+	
+	return out.width > 0 && out.height > 0;
+}
@@ -0,0 +1,95 @@
+//
+// ofxParticleImageDecoder.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef _OFX_PARTICLE_IMAGE_DECODER
+#define _OFX_PARTICLE_IMAGE_DECODER
+
+#include "ofMain.h"
+#include "Poco/SharedPtr.h"
+#include "Poco/Mutex.h"
+
+#define PARTICLE_DECODE_CHUNK	4096		// Bytes read from the inflater at a time
+
+// ------------------------------------------------------------------------
+// ofxParticlePixels
+// ------------------------------------------------------------------------
+
+// Decoded RGBA image, rows from the top
+class ofxParticlePixels
+{
+	
+public:
+	
+	ofxParticlePixels() : width( 0 ), height( 0 ), channels( 0 ) {}
+	
+	std::vector<unsigned char>	pixels;
+	int							width, height, channels;
+};
+
+typedef Poco::SharedPtr<const ofxParticlePixels> ofxParticlePixelsPtr;
+
+// ------------------------------------------------------------------------
+// ofxParticleImageDecoder
+// ------------------------------------------------------------------------
+
+// Decodes the images Particle Designer embeds in the data attribute of the texture tag,
+// which are image files gzipped and then base64 encoded, and sprite image files which are
+// loaded away from the GL thread.  The base64 text is decoded, inflated with the zlib
+// in PocoFoundation, and the image is then decoded from memory.
+// Results are kept by a hash of the text, so configs embedding the same image decode it
+// once.  Safe to use from any thread, nothing here touches GL
+class ofxParticleImageDecoder
+{
+	
+public:
+	
+	static ofxParticleImageDecoder&	getShared();
+	
+	// Return the pixels for data, decoding them the first time.  Null when data cannot be decoded
+	ofxParticlePixelsPtr	decode( const std::string& data );
+	
+	// Same for an image file, matched by a hash of its contents.  The path is used as is
+	ofxParticlePixelsPtr	decodeFile( const std::string& path );
+	
+	// Forget every decoded image.  Configs keep the pixels they hold
+	void	clear();
+	int		getImageCount();
+	
+	// Base64 decode data and inflate it when it is gzip or zlib compressed, appending the
+	// result to out.  Data which is not compressed is appended as decoded
+	static bool		inflateBase64( const std::string& data, std::vector<unsigned char>& out );
+	
+	// Decode an image file held in memory to 4 channel pixels
+	static bool		decodeImage( const unsigned char* file, size_t size, ofxParticlePixels& out );
+	
+protected:
+	
+	// Return the pixels cached under key, or store pixels there when none are
+	ofxParticlePixelsPtr	store( unsigned long long key, ofxParticlePixels* pixels );
+	
+	std::map<unsigned long long, ofxParticlePixelsPtr>	images;
+	Poco::FastMutex										mutex;
+};
+
+#endif
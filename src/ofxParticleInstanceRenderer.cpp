@@ -0,0 +1,308 @@
+//
+// ofxParticleInstanceRenderer.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "ofxParticleInstanceRenderer.h"
+
+// Attribute locations bound before linking.  Location 0 aliases gl_Vertex in compatibility
+// contexts, so it goes to the per vertex corner which is always enabled
+#define ATTRIBUTE_CORNER		0
+#define ATTRIBUTE_POSITION		1
+#define ATTRIBUTE_SIZE			2
+#define ATTRIBUTE_COLOR			3
+
+// Each instance is expanded from the four corners of a unit square around the particle
+static const char* vertexShaderSource =
+	"#version 120\n"
+	"attribute vec2 corner;\n"
+	"attribute vec3 instancePosition;\n"
+	"attribute float instanceSize;\n"
+	"attribute vec4 instanceColor;\n"
+	"uniform vec4 texRect;\n"
+	"varying vec2 texCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	vec3 position = instancePosition + vec3( corner * instanceSize, 0.0 );\n"
+	"	texCoord = mix( texRect.xy, texRect.zw, corner + 0.5 );\n"
+	"	gl_FrontColor = clamp( instanceColor, 0.0, 1.0 );\n"
+	"	gl_Position = gl_ModelViewProjectionMatrix * vec4( position, 1.0 );\n"
+	"}\n";
+
+static const char* fragmentShaderSource =
+	"#version 120\n"
+	"uniform sampler2D sprite;\n"
+	"varying vec2 texCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = texture2D( sprite, texCoord ) * gl_Color;\n"
+	"}\n";
+
+// Rectangle textures, which openFrameworks uses by default, are sampled in pixels
+static const char* fragmentShaderRectSource =
+	"#version 120\n"
+	"#extension GL_ARB_texture_rectangle : enable\n"
+	"uniform sampler2DRect sprite;\n"
+	"varying vec2 texCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = texture2DRect( sprite, texCoord ) * gl_Color;\n"
+	"}\n";
+
+#ifdef PARTICLE_INSTANCING_SUPPORTED
+
+// Instancing is core from OpenGL 3.3, before that it needs both ARB extensions
+enum { kInstancingUnknown = -1, kInstancingNone, kInstancingCore, kInstancingARB };
+static int instancing = kInstancingUnknown;
+static bool halfFloat = false;
+
+static void setDivisor( GLuint index, GLuint divisor )
+{
+	if ( instancing == kInstancingCore )
+		glVertexAttribDivisor( index, divisor );
+	else
+		glVertexAttribDivisorARB( index, divisor );
+}
+
+static void drawInstanced( GLenum mode, GLint first, GLsizei count, GLsizei primcount )
+{
+	if ( instancing == kInstancingCore )
+		glDrawArraysInstanced( mode, first, count, primcount );
+	else
+		glDrawArraysInstancedARB( mode, first, count, primcount );
+}
+
+#endif
+
+// ------------------------------------------------------------------------
+// Support
+// ------------------------------------------------------------------------
+
+bool ofxParticleInstanceRenderer::isSupported()
+{
+#ifdef PARTICLE_INSTANCING_SUPPORTED
+	if ( instancing == kInstancingUnknown )
+	{
+		const char* version = (const char*)glGetString( GL_VERSION );
+		const char* extensions = (const char*)glGetString( GL_EXTENSIONS );
+		
+		int major = 0, minor = 0;
+		if ( version != NULL )
+			sscanf( version, "%d.%d", &major, &minor );
+		
+		if ( major > 3 || ( major == 3 && minor >= 3 ) )
+			instancing = kInstancingCore;
+		else if ( extensions != NULL && strstr( extensions, "GL_ARB_instanced_arrays" ) != NULL && strstr( extensions, "GL_ARB_draw_instanced" ) != NULL && major >= 2 )
+			instancing = kInstancingARB;
+		else
+			instancing = kInstancingNone;
+		
+		// Half float vertex attributes are core from OpenGL 3.0
+		halfFloat = major >= 3 || ( extensions != NULL && strstr( extensions, "GL_ARB_half_float_vertex" ) != NULL );
+		
+		if ( instancing == kInstancingNone )
+			ofLog( OF_LOG_NOTICE, "ofxParticleInstanceRenderer - instancing not available, drawing quads instead" );
+	}
+	
+	return instancing != kInstancingNone;
+#else
+	return false;
+#endif
+}
+
+bool ofxParticleInstanceRenderer::isHalfFloatSupported()
+{
+#ifdef PARTICLE_INSTANCING_SUPPORTED
+	return isSupported() && halfFloat;
+#else
+	return false;
+#endif
+}
+
+// ------------------------------------------------------------------------
+// Resources
+// ------------------------------------------------------------------------
+
+GLuint ofxParticleInstanceRenderer::compile( GLenum type, const char* source )
+{
+	GLuint shader = glCreateShader( type );
+	glShaderSource( shader, 1, &source, NULL );
+	glCompileShader( shader );
+	
+	GLint compiled = 0;
+	glGetShaderiv( shader, GL_COMPILE_STATUS, &compiled );
+	if ( !compiled )
+	{
+		char log[1024];
+		glGetShaderInfoLog( shader, sizeof( log ), NULL, log );
+		ofLog( OF_LOG_ERROR, std::string( "ofxParticleInstanceRenderer::compile() - " ) + log );
+		glDeleteShader( shader );
+		return 0;
+	}
+	
+	return shader;
+}
+
+const ofxParticleInstanceRenderer::Program* ofxParticleInstanceRenderer::getProgram( GLenum textureTarget )
+{
+	// One program per texture target, built the first time it is needed and kept for the
+	// life of the context.  A failed build is remembered so it is not retried every frame
+	static Program programs[2];
+	static bool built[2] = { false, false };
+	
+	bool rect = textureTarget != GL_TEXTURE_2D;
+	Program& p = programs[rect ? 1 : 0];
+	
+	if ( built[rect ? 1 : 0] )
+		return p.program != 0 ? &p : NULL;
+	
+	built[rect ? 1 : 0] = true;
+	p.program = 0;
+	
+	GLuint vertexShader = compile( GL_VERTEX_SHADER, vertexShaderSource );
+	GLuint fragmentShader = compile( GL_FRAGMENT_SHADER, rect ? fragmentShaderRectSource : fragmentShaderSource );
+	
+	if ( vertexShader != 0 && fragmentShader != 0 )
+	{
+		GLuint program = glCreateProgram();
+		glAttachShader( program, vertexShader );
+		glAttachShader( program, fragmentShader );
+		
+		glBindAttribLocation( program, ATTRIBUTE_CORNER, "corner" );
+		glBindAttribLocation( program, ATTRIBUTE_POSITION, "instancePosition" );
+		glBindAttribLocation( program, ATTRIBUTE_SIZE, "instanceSize" );
+		glBindAttribLocation( program, ATTRIBUTE_COLOR, "instanceColor" );
+		
+		glLinkProgram( program );
+		
+		GLint linked = 0;
+		glGetProgramiv( program, GL_LINK_STATUS, &linked );
+		if ( linked )
+		{
+			p.program = program;
+			p.texRect = glGetUniformLocation( program, "texRect" );
+			p.texture = glGetUniformLocation( program, "sprite" );
+		}
+		else
+		{
+			char log[1024];
+			glGetProgramInfoLog( program, sizeof( log ), NULL, log );
+			ofLog( OF_LOG_ERROR, std::string( "ofxParticleInstanceRenderer::getProgram() - " ) + log );
+			glDeleteProgram( program );
+		}
+	}
+	
+	// The program keeps the shaders alive for as long as it needs them
+	if ( vertexShader != 0 )
+		glDeleteShader( vertexShader );
+	if ( fragmentShader != 0 )
+		glDeleteShader( fragmentShader );
+	
+	return p.program != 0 ? &p : NULL;
+}
+
+GLuint ofxParticleInstanceRenderer::getCornerBuffer()
+{
+	static GLuint buffer = 0;
+	
+	if ( buffer == 0 )
+	{
+		// Drawn as a fan, so the corners go around the square
+		static const GLfloat corners[] = { -0.5f, -0.5f,  0.5f, -0.5f,  0.5f, 0.5f,  -0.5f, 0.5f };
+		
+		glGenBuffers( 1, &buffer );
+		glBindBuffer( GL_ARRAY_BUFFER, buffer );
+		glBufferData( GL_ARRAY_BUFFER, sizeof( corners ), corners, GL_STATIC_DRAW );
+	}
+	
+	return buffer;
+}
+
+// ------------------------------------------------------------------------
+// Render
+// ------------------------------------------------------------------------
+
+bool ofxParticleInstanceRenderer::draw( const ofTextureData& texData, const ParticleTexRect& rect, const void* sprites, int count, const ParticleInstanceLayout& layout, ofxParticleStreamBuffer* stream )
+{
+#ifdef PARTICLE_INSTANCING_SUPPORTED
+	if ( !isSupported() )
+		return false;
+	
+	bool usesHalf = layout.positionType == PARTICLE_GL_HALF_FLOAT || layout.sizeType == PARTICLE_GL_HALF_FLOAT;
+	if ( usesHalf && !isHalfFloatSupported() )
+		return false;
+	
+	const Program* p = getProgram( texData.textureTarget );
+	if ( p == NULL )
+		return false;
+	
+	if ( count <= 0 )
+		return true;
+	
+	glUseProgram( p->program );
+	
+	glUniform4f( p->texRect, rect.u0, rect.v0, rect.u1, rect.v1 );
+	glUniform1i( p->texture, 0 );
+	
+	glActiveTexture( GL_TEXTURE0 );
+	glBindTexture( texData.textureTarget, (GLuint)texData.textureID );
+	
+	glBindBuffer( GL_ARRAY_BUFFER, getCornerBuffer() );
+	glEnableVertexAttribArray( ATTRIBUTE_CORNER );
+	glVertexAttribPointer( ATTRIBUTE_CORNER, 2, GL_FLOAT, GL_FALSE, 0, 0 );
+	
+	// Only the particles themselves are sent every frame
+	const char* base = (const char*)stream->upload( sprites, layout.stride * count );
+	
+	glEnableVertexAttribArray( ATTRIBUTE_POSITION );
+	glEnableVertexAttribArray( ATTRIBUTE_SIZE );
+	glEnableVertexAttribArray( ATTRIBUTE_COLOR );
+	
+	glVertexAttribPointer( ATTRIBUTE_POSITION, layout.positionComponents, layout.positionType, GL_FALSE, layout.stride, base + layout.positionOffset );
+	glVertexAttribPointer( ATTRIBUTE_SIZE, 1, layout.sizeType, GL_FALSE, layout.stride, base + layout.sizeOffset );
+	glVertexAttribPointer( ATTRIBUTE_COLOR, 4, layout.colorType, layout.colorNormalized, layout.stride, base + layout.colorOffset );
+	
+	setDivisor( ATTRIBUTE_POSITION, 1 );
+	setDivisor( ATTRIBUTE_SIZE, 1 );
+	setDivisor( ATTRIBUTE_COLOR, 1 );
+	
+	drawInstanced( GL_TRIANGLE_FAN, 0, 4, count );
+	
+	// Leave the attributes as fixed function drawing expects them
+	setDivisor( ATTRIBUTE_POSITION, 0 );
+	setDivisor( ATTRIBUTE_SIZE, 0 );
+	setDivisor( ATTRIBUTE_COLOR, 0 );
+	
+	glDisableVertexAttribArray( ATTRIBUTE_COLOR );
+	glDisableVertexAttribArray( ATTRIBUTE_SIZE );
+	glDisableVertexAttribArray( ATTRIBUTE_POSITION );
+	glDisableVertexAttribArray( ATTRIBUTE_CORNER );
+	
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	glBindTexture( texData.textureTarget, 0 );
+	glUseProgram( 0 );
+	
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,101 @@
+//
+// ofxParticleInstanceRenderer.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef _OFX_PARTICLE_INSTANCE_RENDERER
+#define _OFX_PARTICLE_INSTANCE_RENDERER
+
+#include "ofMain.h"
+#include "ofxParticleStreamBuffer.h"
+#include "ofxParticleQuadBatch.h"
+#include "ofxParticlePackedVertex.h"
+#include <stddef.h>
+
+// Instancing needs shaders and attribute divisors, which OpenGL ES 1 does not have
+#if defined( GL_VERTEX_ATTRIB_ARRAY_DIVISOR_ARB ) || defined( GL_VERTEX_ATTRIB_ARRAY_DIVISOR )
+	#define PARTICLE_INSTANCING_SUPPORTED
+#endif
+
+// ------------------------------------------------------------------------
+// Structures
+// ------------------------------------------------------------------------
+
+// Where the fields of one particle are found in the array handed to the renderer
+typedef struct
+{
+	size_t		stride;					// Bytes from one particle to the next
+	
+	GLint		positionComponents;		// 2 or 3, z is 0 when only 2 are given
+	GLenum		positionType;
+	size_t		positionOffset;
+	
+	GLenum		sizeType;
+	size_t		sizeOffset;
+	
+	GLenum		colorType;
+	GLboolean	colorNormalized;		// True for integer colors which map to 0..1
+	size_t		colorOffset;
+} ParticleInstanceLayout;
+
+// ------------------------------------------------------------------------
+// ofxParticleInstanceRenderer
+// ------------------------------------------------------------------------
+
+// Draws particles straight from their sprite array with one instanced draw call.  Each
+// particle is sent once as an instance record and a vertex shader expands it into a
+// textured quad, so a quarter of the data the quad batch sends crosses the bus and the
+// CPU does no expansion at all.  Needs GLSL 1.20 with instanced arrays, either from
+// OpenGL 3.3 or the ARB extensions, which includes Mesa's software renderers
+class ofxParticleInstanceRenderer
+{
+	
+public:
+	
+	// True when the current context can draw instanced particles
+	static bool		isSupported();
+	
+	// True when half float attributes, used by PackedPointSprite, can be drawn as well
+	static bool		isHalfFloatSupported();
+	
+	// Draw count particles laid out as described, textured with the rect part of texData
+	// and streamed through stream.  The blend function is left to the caller.  Returns
+	// false, drawing nothing, when instancing or the layout's types are not supported, or
+	// the shaders failed to build
+	static bool		draw( const ofTextureData& texData, const ParticleTexRect& rect, const void* sprites, int count, const ParticleInstanceLayout& layout, ofxParticleStreamBuffer* stream );
+	
+protected:
+	
+	// A program built for one texture target, with the locations it uses
+	typedef struct
+	{
+		GLuint		program;
+		GLint		texRect;
+		GLint		texture;
+	} Program;
+	
+	static const Program*	getProgram( GLenum textureTarget );
+	static GLuint			getCornerBuffer();
+	static GLuint			compile( GLenum type, const char* source );
+};
+
+#endif
@@ -0,0 +1,324 @@
+//
+// ofxParticleKernels.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "ofxParticleKernels.h"
+
+// ------------------------------------------------------------------------
+// Instruction set availability
+// ------------------------------------------------------------------------
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+	#define PARTICLE_HAS_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+// AVX2 kernels are compiled with a function attribute rather than a global compiler flag,
+// so they are only ever run on CPUs which report support for them
+#if defined(PARTICLE_HAS_SSE2) && ( ( defined(__GNUC__) && ( __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) ) ) || defined(__clang__) || ( defined(_MSC_VER) && _MSC_VER >= 1700 ) )
+	#define PARTICLE_HAS_AVX2 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define PARTICLE_TARGET_AVX2
+	#else
+		#include <cpuid.h>
+		#define PARTICLE_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+	#define PARTICLE_HAS_NEON 1
+	#include <arm_neon.h>
+#endif
+
+// ------------------------------------------------------------------------
+// Lanes
+// ------------------------------------------------------------------------
+
+// One particle at a time
+struct ScalarLane
+{
+	typedef float V;
+	typedef bool M;
+	enum { width = 1 };
+
+	static inline V load( const float* p )	{ return *p; }
+	static inline void store( float* p, V v )	{ *p = v; }
+	static inline V set( float f )			{ return f; }
+	static inline V add( V a, V b )			{ return a + b; }
+	static inline V sub( V a, V b )			{ return a - b; }
+	static inline V mul( V a, V b )			{ return a * b; }
+	static inline V neg( V a )				{ return -a; }
+	static inline V rsqrt( V a )			{ return 1.0f / sqrtf( a ); }
+	static inline V floor( V a )			{ return floorf( a ); }
+	static inline M cmpgt( V a, V b )		{ return a > b; }
+	static inline M cmplt( V a, V b )		{ return a < b; }
+	static inline M mask_and( M a, M b )	{ return a && b; }
+	static inline V select( M m, V a, V b )	{ return m ? a : b; }
+};
+
+#ifdef PARTICLE_HAS_SSE2
+
+// Four particles at a time
+struct SSE2Lane
+{
+	typedef __m128 V;
+	typedef __m128 M;
+	enum { width = 4 };
+
+	static inline V load( const float* p )	{ return _mm_loadu_ps( p ); }
+	static inline void store( float* p, V v )	{ _mm_storeu_ps( p, v ); }
+	static inline V set( float f )			{ return _mm_set1_ps( f ); }
+	static inline V add( V a, V b )			{ return _mm_add_ps( a, b ); }
+	static inline V sub( V a, V b )			{ return _mm_sub_ps( a, b ); }
+	static inline V mul( V a, V b )			{ return _mm_mul_ps( a, b ); }
+	static inline V neg( V a )				{ return _mm_xor_ps( a, _mm_set1_ps( -0.0f ) ); }
+	static inline V rsqrt( V a )			{ return _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_sqrt_ps( a ) ); }
+	static inline M cmpgt( V a, V b )		{ return _mm_cmpgt_ps( a, b ); }
+	static inline M cmplt( V a, V b )		{ return _mm_cmplt_ps( a, b ); }
+	static inline M mask_and( M a, M b )	{ return _mm_and_ps( a, b ); }
+	static inline V select( M m, V a, V b )	{ return _mm_or_ps( _mm_and_ps( m, a ), _mm_andnot_ps( m, b ) ); }
+
+	// SSE2 has no rounding instruction, so truncate and correct negative values
+	static inline V floor( V a )
+	{
+		V t = _mm_cvtepi32_ps( _mm_cvttps_epi32( a ) );
+		return _mm_sub_ps( t, _mm_and_ps( _mm_cmpgt_ps( t, a ), _mm_set1_ps( 1.0f ) ) );
+	}
+};
+
+#endif
+
+#ifdef PARTICLE_HAS_AVX2
+
+// Eight particles at a time
+struct AVX2Lane
+{
+	typedef __m256 V;
+	typedef __m256 M;
+	enum { width = 8 };
+
+	PARTICLE_TARGET_AVX2 static inline V load( const float* p )	{ return _mm256_loadu_ps( p ); }
+	PARTICLE_TARGET_AVX2 static inline void store( float* p, V v )	{ _mm256_storeu_ps( p, v ); }
+	PARTICLE_TARGET_AVX2 static inline V set( float f )			{ return _mm256_set1_ps( f ); }
+	PARTICLE_TARGET_AVX2 static inline V add( V a, V b )			{ return _mm256_add_ps( a, b ); }
+	PARTICLE_TARGET_AVX2 static inline V sub( V a, V b )			{ return _mm256_sub_ps( a, b ); }
+	PARTICLE_TARGET_AVX2 static inline V mul( V a, V b )			{ return _mm256_mul_ps( a, b ); }
+	PARTICLE_TARGET_AVX2 static inline V neg( V a )				{ return _mm256_xor_ps( a, _mm256_set1_ps( -0.0f ) ); }
+	PARTICLE_TARGET_AVX2 static inline V rsqrt( V a )			{ return _mm256_div_ps( _mm256_set1_ps( 1.0f ), _mm256_sqrt_ps( a ) ); }
+	PARTICLE_TARGET_AVX2 static inline V floor( V a )			{ return _mm256_floor_ps( a ); }
+	PARTICLE_TARGET_AVX2 static inline M cmpgt( V a, V b )		{ return _mm256_cmp_ps( a, b, _CMP_GT_OQ ); }
+	PARTICLE_TARGET_AVX2 static inline M cmplt( V a, V b )		{ return _mm256_cmp_ps( a, b, _CMP_LT_OQ ); }
+	PARTICLE_TARGET_AVX2 static inline M mask_and( M a, M b )	{ return _mm256_and_ps( a, b ); }
+	PARTICLE_TARGET_AVX2 static inline V select( M m, V a, V b )	{ return _mm256_blendv_ps( b, a, m ); }
+};
+
+#endif
+
+#ifdef PARTICLE_HAS_NEON
+
+// Four particles at a time
+struct NEONLane
+{
+	typedef float32x4_t V;
+	typedef uint32x4_t M;
+	enum { width = 4 };
+
+	static inline V load( const float* p )	{ return vld1q_f32( p ); }
+	static inline void store( float* p, V v )	{ vst1q_f32( p, v ); }
+	static inline V set( float f )			{ return vdupq_n_f32( f ); }
+	static inline V add( V a, V b )			{ return vaddq_f32( a, b ); }
+	static inline V sub( V a, V b )			{ return vsubq_f32( a, b ); }
+	static inline V mul( V a, V b )			{ return vmulq_f32( a, b ); }
+	static inline V neg( V a )				{ return vnegq_f32( a ); }
+	static inline M cmpgt( V a, V b )		{ return vcgtq_f32( a, b ); }
+	static inline M cmplt( V a, V b )		{ return vcltq_f32( a, b ); }
+	static inline M mask_and( M a, M b )	{ return vandq_u32( a, b ); }
+	static inline V select( M m, V a, V b )	{ return vbslq_f32( m, a, b ); }
+
+	// ARMv7 has no vector divide or square root, so refine the estimate twice
+	static inline V rsqrt( V a )
+	{
+		V e = vrsqrteq_f32( a );
+		e = vmulq_f32( e, vrsqrtsq_f32( vmulq_f32( a, e ), e ) );
+		e = vmulq_f32( e, vrsqrtsq_f32( vmulq_f32( a, e ), e ) );
+		return e;
+	}
+
+	static inline V floor( V a )
+	{
+		V t = vcvtq_f32_s32( vcvtq_s32_f32( a ) );
+		uint32x4_t greater = vcgtq_f32( t, a );
+		return vsubq_f32( t, vreinterpretq_f32_u32( vandq_u32( greater, vreinterpretq_u32_f32( vdupq_n_f32( 1.0f ) ) ) ) );
+	}
+};
+
+#endif
+
+// ------------------------------------------------------------------------
+// Kernels
+// ------------------------------------------------------------------------
+
+#define PARTICLE_LANE			ScalarLane
+#define PARTICLE_TARGET
+#define PARTICLE_KERNEL(name)	Particle##name##Scalar
+#include "ofxParticleKernels.inl"
+#undef PARTICLE_LANE
+#undef PARTICLE_TARGET
+#undef PARTICLE_KERNEL
+
+#ifdef PARTICLE_HAS_SSE2
+#define PARTICLE_LANE			SSE2Lane
+#define PARTICLE_TARGET
+#define PARTICLE_KERNEL(name)	Particle##name##SSE2
+#include "ofxParticleKernels.inl"
+#undef PARTICLE_LANE
+#undef PARTICLE_TARGET
+#undef PARTICLE_KERNEL
+#endif
+
+#ifdef PARTICLE_HAS_AVX2
+#define PARTICLE_LANE			AVX2Lane
+#define PARTICLE_TARGET			PARTICLE_TARGET_AVX2
+#define PARTICLE_KERNEL(name)	Particle##name##AVX2
+#include "ofxParticleKernels.inl"
+#undef PARTICLE_LANE
+#undef PARTICLE_TARGET
+#undef PARTICLE_KERNEL
+#endif
+
+#ifdef PARTICLE_HAS_NEON
+#define PARTICLE_LANE			NEONLane
+#define PARTICLE_TARGET
+#define PARTICLE_KERNEL(name)	Particle##name##NEON
+#include "ofxParticleKernels.inl"
+#undef PARTICLE_LANE
+#undef PARTICLE_TARGET
+#undef PARTICLE_KERNEL
+#endif
+
+static const ParticleKernels kernelTable[kParticleKernelISACount] =
+{
+	{ kParticleKernelScalar, 1, "scalar", ParticleIntegrateTableScalar, ParticleSinCosArrayScalar },
+#ifdef PARTICLE_HAS_SSE2
+	{ kParticleKernelSSE2, 4, "sse2", ParticleIntegrateTableSSE2, ParticleSinCosArraySSE2 },
+#else
+	{ kParticleKernelSSE2, 0, "sse2", NULL, NULL },
+#endif
+#ifdef PARTICLE_HAS_AVX2
+	{ kParticleKernelAVX2, 8, "avx2", ParticleIntegrateTableAVX2, ParticleSinCosArrayAVX2 },
+#else
+	{ kParticleKernelAVX2, 0, "avx2", NULL, NULL },
+#endif
+#ifdef PARTICLE_HAS_NEON
+	{ kParticleKernelNEON, 4, "neon", ParticleIntegrateTableNEON, ParticleSinCosArrayNEON },
+#else
+	{ kParticleKernelNEON, 0, "neon", NULL, NULL },
+#endif
+};
+
+// ------------------------------------------------------------------------
+// CPU feature detection
+// ------------------------------------------------------------------------
+
+#ifdef PARTICLE_HAS_AVX2
+
+static bool cpuSupportsAVX2()
+{
+	unsigned int regs[4] = { 0, 0, 0, 0 };
+
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid( info, 0 );
+	if ( info[0] < 7 )
+		return false;
+	__cpuid( info, 1 );
+	regs[2] = info[2];
+#else
+	if ( __get_cpuid_max( 0, NULL ) < 7 )
+		return false;
+	__cpuid( 1, regs[0], regs[1], regs[2], regs[3] );
+#endif
+
+	// The OS has to save the YMM registers on a context switch for AVX to be usable
+	bool osxsave = ( regs[2] & ( 1 << 27 ) ) != 0;
+	bool avx = ( regs[2] & ( 1 << 28 ) ) != 0;
+	if ( !osxsave || !avx )
+		return false;
+
+#if defined(_MSC_VER)
+	unsigned long long xcr0 = _xgetbv( 0 );
+	__cpuidex( info, 7, 0 );
+	regs[1] = info[1];
+#else
+	unsigned int xcr0Low, xcr0High;
+	__asm__ __volatile__ ( "xgetbv" : "=a" (xcr0Low), "=d" (xcr0High) : "c" (0) );
+	unsigned long long xcr0 = xcr0Low;
+	__cpuid_count( 7, 0, regs[0], regs[1], regs[2], regs[3] );
+#endif
+
+	if ( ( xcr0 & 0x6 ) != 0x6 )
+		return false;
+
+	return ( regs[1] & ( 1 << 5 ) ) != 0;
+}
+
+#endif
+
+int ofxParticleDetectKernelISA()
+{
+#ifdef PARTICLE_HAS_AVX2
+	if ( cpuSupportsAVX2() )
+		return kParticleKernelAVX2;
+#endif
+#ifdef PARTICLE_HAS_SSE2
+	return kParticleKernelSSE2;
+#elif defined(PARTICLE_HAS_NEON)
+	return kParticleKernelNEON;
+#else
+	return kParticleKernelScalar;
+#endif
+}
+
+const ParticleKernels* ofxParticleGetKernels()
+{
+	static const ParticleKernels* detected = NULL;
+
+	if ( detected == NULL )
+		detected = &kernelTable[ofxParticleDetectKernelISA()];
+
+	return detected;
+}
+
+const ParticleKernels* ofxParticleGetKernels( int isa )
+{
+	if ( isa < 0 || isa >= kParticleKernelISACount || kernelTable[isa].integrate == NULL )
+		return NULL;
+
+#ifdef PARTICLE_HAS_AVX2
+	if ( isa == kParticleKernelAVX2 && !cpuSupportsAVX2() )
+		return NULL;
+#endif
+
+	return &kernelTable[isa];
+}
@@ -0,0 +1,101 @@
+//
+// ofxParticleKernels.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef _OFX_PARTICLE_KERNELS
+#define _OFX_PARTICLE_KERNELS
+
+#include "ofxParticlePool.h"
+
+// ------------------------------------------------------------------------
+// Structures
+// ------------------------------------------------------------------------
+
+// Instruction sets the integration kernels are built for
+enum kParticleKernelISAs
+{
+	kParticleKernelScalar,
+	kParticleKernelSSE2,
+	kParticleKernelAVX2,
+	kParticleKernelNEON,
+
+	kParticleKernelISACount
+};
+
+// Features of a config the integration kernels are specialized on.  Every combination
+// has its own kernel, so particles only pay for what their emitter uses
+enum kParticleFeatures
+{
+	kParticleFeatureRadial		= 1 << 0,	// kParticleTypeRadial, which ignores acceleration and gravity
+	kParticleFeatureAccel		= 1 << 1,	// Radial or tangential acceleration
+	kParticleFeatureGravity		= 1 << 2,
+	kParticleFeatureColor		= 1 << 3,	// Color changes over a particle's life
+	kParticleFeatureSize		= 1 << 4,	// Size changes over a particle's life
+	kParticleFeatureDepth		= 1 << 5,	// Particles move in z as well, set for 3D pools
+
+	kParticleFeatureCombinations = 1 << 6
+};
+
+// Per update values shared by every particle the kernels integrate
+typedef struct
+{
+	GLfloat		delta;
+	GLfloat		gravityX, gravityY, gravityZ;
+	GLfloat		sourceX, sourceY, sourceZ;
+	GLfloat		minRadius;
+} ParticleKernelParams;
+
+// Integrates the particles in [begin, end) of the pool
+typedef void (*ParticleKernel)( ParticlePool* pool, int begin, int end, const ParticleKernelParams* params );
+
+// Writes the sin and cos of count angles
+typedef void (*ParticleSinCosKernel)( const GLfloat* x, GLfloat* s, GLfloat* c, int count );
+
+// A set of kernels built for one instruction set
+typedef struct
+{
+	int				isa;		// One of kParticleKernelISAs
+	int				width;		// Number of particles processed per step
+	const char*		name;
+	const ParticleKernel*	integrate;	// Whole update of position, color and size, indexed by kParticleFeatures
+	ParticleSinCosKernel	sinCos;	// Used when initializing particles in bulk
+} ParticleKernels;
+
+// ------------------------------------------------------------------------
+// Kernel selection
+// ------------------------------------------------------------------------
+
+// The vector kernels agree with the scalar kernels to within 1e-5 relative error on
+// gravity mode positions.  Radial mode evaluates sin and cos with a polynomial, which
+// stays within 2e-6 absolute error of sinf and cosf for angles up to a few thousand
+// radians, so positions agree to within 2e-6 * radius.
+
+// Returns the widest instruction set both compiled in and supported by this CPU
+int						ofxParticleDetectKernelISA();
+
+// Returns the kernels for the detected instruction set
+const ParticleKernels*	ofxParticleGetKernels();
+
+// Returns the kernels for a specific instruction set, or NULL when it is not available
+const ParticleKernels*	ofxParticleGetKernels( int isa );
+
+#endif
@@ -0,0 +1,275 @@
+//
+// ofxParticleKernels.inl
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Kernel bodies shared by every instruction set.  This file is included once per
+// instruction set by ofxParticleKernels.cpp with the following defined:
+//
+//   PARTICLE_LANE			lane type providing the vector operations
+//   PARTICLE_TARGET		function attribute enabling the instruction set
+//   PARTICLE_KERNEL(name)	decorates a function name with the instruction set
+
+// ------------------------------------------------------------------------
+// Math
+// ------------------------------------------------------------------------
+
+// Evaluate sin and cos of x together.  x is reduced to [-PI/4, PI/4] around the nearest
+// multiple of PI/2 and the quadrant picks which polynomial and sign each result uses
+template<class L>
+PARTICLE_TARGET static inline void PARTICLE_KERNEL(SinCos)( typename L::V x, typename L::V& s, typename L::V& c )
+{
+	typedef typename L::V V;
+	typedef typename L::M M;
+
+	V q = L::floor( L::add( L::mul( x, L::set( 0.63661977236758134f ) ), L::set( 0.5f ) ) );
+
+	V r = L::sub( x, L::mul( q, L::set( 1.5703125f ) ) );
+	r = L::sub( r, L::mul( q, L::set( 4.837512969970703125e-4f ) ) );
+	r = L::sub( r, L::mul( q, L::set( 7.549789948768648e-8f ) ) );
+
+	V r2 = L::mul( r, r );
+
+	V sp = L::add( L::mul( r2, L::set( -1.9515295891e-4f ) ), L::set( 8.3321608736e-3f ) );
+	sp = L::add( L::mul( sp, r2 ), L::set( -1.6666654611e-1f ) );
+	sp = L::add( L::mul( L::mul( sp, r2 ), r ), r );
+
+	V cp = L::add( L::mul( r2, L::set( 2.443315711809948e-5f ) ), L::set( -1.388731625493765e-3f ) );
+	cp = L::add( L::mul( cp, r2 ), L::set( 4.166664568298827e-2f ) );
+	cp = L::add( L::mul( L::mul( cp, r2 ), r2 ), L::sub( L::set( 1.0f ), L::mul( r2, L::set( 0.5f ) ) ) );
+
+	// Quadrant 0..3 of x, kept as a float so no integer vector operations are needed
+	V n = L::sub( q, L::mul( L::floor( L::mul( q, L::set( 0.25f ) ) ), L::set( 4.0f ) ) );
+	V parity = L::sub( n, L::mul( L::floor( L::mul( n, L::set( 0.5f ) ) ), L::set( 2.0f ) ) );
+
+	M odd = L::cmpgt( parity, L::set( 0.5f ) );
+	M negateSin = L::cmpgt( n, L::set( 1.5f ) );
+	M negateCos = L::mask_and( L::cmpgt( n, L::set( 0.5f ) ), L::cmplt( n, L::set( 2.5f ) ) );
+
+	V sinValue = L::select( odd, cp, sp );
+	V cosValue = L::select( odd, sp, cp );
+
+	s = L::select( negateSin, L::neg( sinValue ), sinValue );
+	c = L::select( negateCos, L::neg( cosValue ), cosValue );
+}
+
+// Single particles use the C library so the scalar kernels match the array storage mode exactly
+template<>
+PARTICLE_TARGET inline void PARTICLE_KERNEL(SinCos)<ScalarLane>( float x, float& s, float& c )
+{
+	s = sinf( x );
+	c = cosf( x );
+}
+
+// ------------------------------------------------------------------------
+// Gravity
+// ------------------------------------------------------------------------
+
+// Integrate L::width particles starting at i.  With Depth the radial direction is taken
+// in 3D and the tangential direction turns about the z axis
+template<class L, bool Depth>
+PARTICLE_TARGET static inline void PARTICLE_KERNEL(GravityStep)( ParticlePool* pool, int i, const ParticleKernelParams* params )
+{
+	typedef typename L::V V;
+	typedef typename L::M M;
+
+	const V delta = L::set( params->delta );
+	const V zero = L::set( 0.0f );
+
+	V sx = L::load( pool->startPosX + i );
+	V sy = L::load( pool->startPosY + i );
+
+	// Work relative to the start position of the particle
+	V x = L::sub( L::load( pool->positionX + i ), sx );
+	V y = L::sub( L::load( pool->positionY + i ), sy );
+
+	V sz = zero, z = zero;
+	V lengthSq = L::add( L::mul( x, x ), L::mul( y, y ) );
+	if ( Depth ) {
+		sz = L::load( pool->startPosZ + i );
+		z = L::sub( L::load( pool->positionZ + i ), sz );
+		lengthSq = L::add( lengthSq, L::mul( z, z ) );
+	}
+
+	// Normalize the offset to get the radial direction, leaving it zero at the origin
+	M nonZero = L::cmpgt( lengthSq, zero );
+	V invLength = L::select( nonZero, L::rsqrt( lengthSq ), zero );
+	V radialX = L::mul( x, invLength );
+	V radialY = L::mul( y, invLength );
+
+	// The tangential direction is the radial direction rotated by 90 degrees
+	V ra = L::load( pool->radialAcceleration + i );
+	V ta = L::load( pool->tangentialAcceleration + i );
+	V ax = L::add( L::sub( L::mul( radialX, ra ), L::mul( radialY, ta ) ), L::set( params->gravityX ) );
+	V ay = L::add( L::add( L::mul( radialY, ra ), L::mul( radialX, ta ) ), L::set( params->gravityY ) );
+
+	V dx = L::add( L::load( pool->directionX + i ), L::mul( ax, delta ) );
+	V dy = L::add( L::load( pool->directionY + i ), L::mul( ay, delta ) );
+	L::store( pool->directionX + i, dx );
+	L::store( pool->directionY + i, dy );
+
+	L::store( pool->positionX + i, L::add( L::add( x, L::mul( dx, delta ) ), sx ) );
+	L::store( pool->positionY + i, L::add( L::add( y, L::mul( dy, delta ) ), sy ) );
+
+	if ( Depth ) {
+		V az = L::add( L::mul( L::mul( z, invLength ), ra ), L::set( params->gravityZ ) );
+		V dz = L::add( L::load( pool->directionZ + i ), L::mul( az, delta ) );
+		L::store( pool->directionZ + i, dz );
+		L::store( pool->positionZ + i, L::add( L::add( z, L::mul( dz, delta ) ), sz ) );
+	}
+}
+
+// ------------------------------------------------------------------------
+// Radial
+// ------------------------------------------------------------------------
+
+// Spin L::width particles starting at i around the source position, in the plane of its z
+template<class L, bool Depth>
+PARTICLE_TARGET static inline void PARTICLE_KERNEL(RadialStep)( ParticlePool* pool, int i, const ParticleKernelParams* params )
+{
+	typedef typename L::V V;
+	typedef typename L::M M;
+
+	V angle = L::add( L::load( pool->angle + i ), L::mul( L::load( pool->degreesPerSecond + i ), L::set( params->delta ) ) );
+	V radius = L::sub( L::load( pool->radius + i ), L::mul( L::load( pool->radiusDelta + i ), L::set( params->delta ) ) );
+	L::store( pool->angle + i, angle );
+	L::store( pool->radius + i, radius );
+
+	V s, c;
+	PARTICLE_KERNEL(SinCos)<L>( angle, s, c );
+
+	L::store( pool->positionX + i, L::sub( L::set( params->sourceX ), L::mul( c, radius ) ) );
+	L::store( pool->positionY + i, L::sub( L::set( params->sourceY ), L::mul( s, radius ) ) );
+	if ( Depth )
+		L::store( pool->positionZ + i, L::set( params->sourceZ ) );
+
+	// Particles which have moved inside minRadius are flagged dead
+	M inside = L::cmplt( radius, L::set( params->minRadius ) );
+	L::store( pool->timeToLive + i, L::select( inside, L::set( 0.0f ), L::load( pool->timeToLive + i ) ) );
+}
+
+// ------------------------------------------------------------------------
+// Specialized
+// ------------------------------------------------------------------------
+
+// Gravity mode without radial or tangential acceleration, so no direction is needed
+template<class L, bool HasGravity, bool Depth>
+PARTICLE_TARGET static inline void PARTICLE_KERNEL(BallisticStep)( ParticlePool* pool, int i, const ParticleKernelParams* params )
+{
+	typedef typename L::V V;
+
+	const V delta = L::set( params->delta );
+
+	V dx = L::load( pool->directionX + i );
+	V dy = L::load( pool->directionY + i );
+	if ( HasGravity ) {
+		dx = L::add( dx, L::mul( L::set( params->gravityX ), delta ) );
+		dy = L::add( dy, L::mul( L::set( params->gravityY ), delta ) );
+		L::store( pool->directionX + i, dx );
+		L::store( pool->directionY + i, dy );
+	}
+
+	L::store( pool->positionX + i, L::add( L::load( pool->positionX + i ), L::mul( dx, delta ) ) );
+	L::store( pool->positionY + i, L::add( L::load( pool->positionY + i ), L::mul( dy, delta ) ) );
+
+	if ( Depth ) {
+		V dz = L::load( pool->directionZ + i );
+		if ( HasGravity ) {
+			dz = L::add( dz, L::mul( L::set( params->gravityZ ), delta ) );
+			L::store( pool->directionZ + i, dz );
+		}
+		L::store( pool->positionZ + i, L::add( L::load( pool->positionZ + i ), L::mul( dz, delta ) ) );
+	}
+}
+
+// Integrate L::width particles starting at i with only the features in Flags.  The tests
+// on Flags are resolved when the template is instantiated
+template<class L, int Flags>
+PARTICLE_TARGET static inline void PARTICLE_KERNEL(IntegrateStep)( ParticlePool* pool, int i, const ParticleKernelParams* params )
+{
+	typedef typename L::V V;
+
+	const bool depth = ( Flags & kParticleFeatureDepth ) != 0;
+
+	if ( Flags & kParticleFeatureRadial )
+		PARTICLE_KERNEL(RadialStep)<L, depth>( pool, i, params );
+	else if ( Flags & kParticleFeatureAccel )
+		PARTICLE_KERNEL(GravityStep)<L, depth>( pool, i, params );
+	else
+		PARTICLE_KERNEL(BallisticStep)<L, ( Flags & kParticleFeatureGravity ) != 0, depth>( pool, i, params );
+
+	const V delta = L::set( params->delta );
+
+	if ( Flags & kParticleFeatureColor ) {
+		L::store( pool->colorRed + i, L::add( L::load( pool->colorRed + i ), L::mul( L::load( pool->deltaColorRed + i ), delta ) ) );
+		L::store( pool->colorGreen + i, L::add( L::load( pool->colorGreen + i ), L::mul( L::load( pool->deltaColorGreen + i ), delta ) ) );
+		L::store( pool->colorBlue + i, L::add( L::load( pool->colorBlue + i ), L::mul( L::load( pool->deltaColorBlue + i ), delta ) ) );
+		L::store( pool->colorAlpha + i, L::add( L::load( pool->colorAlpha + i ), L::mul( L::load( pool->deltaColorAlpha + i ), delta ) ) );
+	}
+
+	if ( Flags & kParticleFeatureSize )
+		L::store( pool->particleSize + i, L::add( L::load( pool->particleSize + i ), L::mul( L::load( pool->particleSizeDelta + i ), delta ) ) );
+}
+
+template<int Flags>
+PARTICLE_TARGET static void PARTICLE_KERNEL(Integrate)( ParticlePool* pool, int begin, int end, const ParticleKernelParams* params )
+{
+	int i = begin;
+	for( ; i + PARTICLE_LANE::width <= end; i += PARTICLE_LANE::width )
+		PARTICLE_KERNEL(IntegrateStep)<PARTICLE_LANE, Flags>( pool, i, params );
+
+	for( ; i < end; i++ )
+		PARTICLE_KERNEL(IntegrateStep)<ScalarLane, Flags>( pool, i, params );
+}
+
+#define PARTICLE_INTEGRATE_4(n)	PARTICLE_KERNEL(Integrate)<n>, PARTICLE_KERNEL(Integrate)<n + 1>, \
+								PARTICLE_KERNEL(Integrate)<n + 2>, PARTICLE_KERNEL(Integrate)<n + 3>
+
+static const ParticleKernel PARTICLE_KERNEL(IntegrateTable)[kParticleFeatureCombinations] =
+{
+	PARTICLE_INTEGRATE_4(0), PARTICLE_INTEGRATE_4(4), PARTICLE_INTEGRATE_4(8), PARTICLE_INTEGRATE_4(12),
+	PARTICLE_INTEGRATE_4(16), PARTICLE_INTEGRATE_4(20), PARTICLE_INTEGRATE_4(24), PARTICLE_INTEGRATE_4(28),
+	PARTICLE_INTEGRATE_4(32), PARTICLE_INTEGRATE_4(36), PARTICLE_INTEGRATE_4(40), PARTICLE_INTEGRATE_4(44),
+	PARTICLE_INTEGRATE_4(48), PARTICLE_INTEGRATE_4(52), PARTICLE_INTEGRATE_4(56), PARTICLE_INTEGRATE_4(60)
+};
+
+#undef PARTICLE_INTEGRATE_4
+
+// ------------------------------------------------------------------------
+// Spawning
+// ------------------------------------------------------------------------
+
+// Evaluate sin and cos for a block of angles, used when initializing particles in bulk
+PARTICLE_TARGET static void PARTICLE_KERNEL(SinCosArray)( const GLfloat* x, GLfloat* s, GLfloat* c, int count )
+{
+	typedef PARTICLE_LANE L;
+
+	int i = 0;
+	for( ; i + L::width <= count; i += L::width ) {
+		L::V vs, vc;
+		PARTICLE_KERNEL(SinCos)<L>( L::load( x + i ), vs, vc );
+		L::store( s + i, vs );
+		L::store( c + i, vc );
+	}
+
+	for( ; i < count; i++ )
+		PARTICLE_KERNEL(SinCos)<ScalarLane>( x[i], s[i], c[i] );
+}
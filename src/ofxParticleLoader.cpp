@@ -0,0 +1,267 @@
+//
+// ofxParticleLoader.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "ofxParticleLoader.h"
+#include "Poco/Timestamp.h"
+
+// Remove request from a queue if it is in it
+static void removeRequest( std::deque<ofxParticleLoadHandle>& requests, const ofxParticleLoadRequest* request )
+{
+	for ( std::deque<ofxParticleLoadHandle>::iterator it = requests.begin(); it != requests.end(); ++it )
+	{
+		if ( it->get() == request )
+		{
+			requests.erase( it );
+			return;
+		}
+	}
+}
+
+// ------------------------------------------------------------------------
+// ofxParticleLoadRequest
+// ------------------------------------------------------------------------
+
+ofxParticleLoadRequest::ofxParticleLoadRequest( const std::string& aFilename )
+{
+	filename = aFilename;
+	loader = NULL;
+	state = kParticleLoadQueued;
+}
+
+int ofxParticleLoadRequest::getState()
+{
+	if ( loader == NULL )
+		return state;
+	
+	return loader->getState( this );
+}
+
+bool ofxParticleLoadRequest::isDone()
+{
+	return getState() == kParticleLoadDone;
+}
+
+bool ofxParticleLoadRequest::hasFailed()
+{
+	return getState() == kParticleLoadFailed;
+}
+
+const std::string& ofxParticleLoadRequest::getFilename() const
+{
+	return filename;
+}
+
+void ofxParticleLoadRequest::cancel()
+{
+	if ( loader != NULL )
+		loader->cancel( this );
+}
+
+bool ofxParticleLoadRequest::prepare()
+{
+	config = ofxParticleConfigCache::getShared().load( filename );
+	if ( config.isNull() )
+		return false;
+	
+	// Decode the sprite file here rather than on the GL thread.  If that fails the GL
+	// thread tries the file itself, so the error is reported the usual way
+	if ( config->texturePixels == NULL && config->textureName != "" )
+		pixels = ofxParticleImageDecoder::getShared().decodeFile( ofToDataPath( config->textureName ) );
+	
+	return true;
+}
+
+// ------------------------------------------------------------------------
+// Lifecycle
+// ------------------------------------------------------------------------
+
+ofxParticleLoader::ofxParticleLoader()
+{
+	preparing = NULL;
+	started = stopping = false;
+}
+
+ofxParticleLoader::~ofxParticleLoader()
+{
+	if ( !started )
+		return;
+	
+	{
+		Poco::FastMutex::ScopedLock lock( mutex );
+		stopping = true;
+	}
+	
+	wake.set();
+	thread.join();
+}
+
+ofxParticleLoader& ofxParticleLoader::getShared()
+{
+	static ofxParticleLoader shared;
+	return shared;
+}
+
+// ------------------------------------------------------------------------
+// Requests
+// ------------------------------------------------------------------------
+
+void ofxParticleLoader::load( const ofxParticleLoadHandle& request )
+{
+	{
+		Poco::FastMutex::ScopedLock lock( mutex );
+		
+		request->loader = this;
+		request->state = kParticleLoadQueued;
+		queued.push_back( request );
+		
+		if ( !started )
+		{
+			started = true;
+			thread.start( *this );
+		}
+	}
+	
+	wake.set();
+}
+
+void ofxParticleLoader::cancel( ofxParticleLoadRequest* request )
+{
+	for ( ;; )
+	{
+		{
+			Poco::FastMutex::ScopedLock lock( mutex );
+			
+			int state = request->state;
+			if ( state != kParticleLoadDone && state != kParticleLoadFailed )
+				request->state = kParticleLoadCancelled;
+			
+			// The loader thread writes into the emitter while preparing, so wait for it
+			if ( preparing != request )
+			{
+				removeRequest( queued, request );
+				removeRequest( finishing, request );
+				return;
+			}
+		}
+		
+		prepared.wait();
+	}
+}
+
+int ofxParticleLoader::getPendingCount()
+{
+	Poco::FastMutex::ScopedLock lock( mutex );
+	return (int)( queued.size() + finishing.size() ) + ( preparing != NULL ? 1 : 0 );
+}
+
+int ofxParticleLoader::getState( const ofxParticleLoadRequest* request )
+{
+	Poco::FastMutex::ScopedLock lock( mutex );
+	return request->state;
+}
+
+// ------------------------------------------------------------------------
+// Loading
+// ------------------------------------------------------------------------
+
+void ofxParticleLoader::run()
+{
+	for ( ;; )
+	{
+		wake.wait();
+		
+		// Work through everything queued before waiting again
+		for ( ;; )
+		{
+			ofxParticleLoadHandle request;
+			
+			{
+				Poco::FastMutex::ScopedLock lock( mutex );
+				
+				if ( stopping )
+					return;
+				if ( queued.empty() )
+					break;
+				
+				request = queued.front();
+				queued.pop_front();
+				request->state = kParticleLoadPreparing;
+				preparing = request.get();
+			}
+			
+			bool ok = request->prepare();
+			
+			{
+				Poco::FastMutex::ScopedLock lock( mutex );
+				
+				preparing = NULL;
+				
+				// Cancelled requests are dropped here
+				if ( request->state == kParticleLoadPreparing )
+				{
+					if ( ok )
+					{
+						request->state = kParticleLoadFinishing;
+						finishing.push_back( request );
+					}
+					else
+					{
+						request->state = kParticleLoadFailed;
+						ofLog( OF_LOG_ERROR, "ofxParticleLoader::run() - unable to load " + request->filename );
+					}
+				}
+			}
+			
+			prepared.set();
+		}
+	}
+}
+
+void ofxParticleLoader::update( GLfloat budget )
+{
+	Poco::Timestamp start;
+	
+	do
+	{
+		ofxParticleLoadHandle request;
+		
+		{
+			Poco::FastMutex::ScopedLock lock( mutex );
+			
+			if ( finishing.empty() )
+				return;
+			
+			request = finishing.front();
+		}
+		
+		if ( !request->finishStep() )
+			continue;
+		
+		Poco::FastMutex::ScopedLock lock( mutex );
+		
+		removeRequest( finishing, request.get() );
+		request->state = kParticleLoadDone;
+	}
+	while ( start.elapsed() < (Poco::Timestamp::TimeDiff)( budget * 1000.0f ) );
+}
@@ -0,0 +1,171 @@
+//
+// ofxParticleLoader.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef _OFX_PARTICLE_LOADER
+#define _OFX_PARTICLE_LOADER
+
+#include "ofMain.h"
+#include "ofxParticleEmitterConfig.h"
+#include "ofxParticleImageDecoder.h"
+#include "Poco/Thread.h"
+#include "Poco/Runnable.h"
+#include "Poco/Event.h"
+#include "Poco/Mutex.h"
+#include "Poco/SharedPtr.h"
+#include <deque>
+
+#define PARTICLE_LOADER_BUDGET		2.0f		// Milliseconds per frame spent finishing loads by default
+
+// ------------------------------------------------------------------------
+// Structures
+// ------------------------------------------------------------------------
+
+enum kParticleLoadStates
+{
+	kParticleLoadQueued,		// Waiting for the loader thread
+	kParticleLoadPreparing,		// Being read and decoded on the loader thread
+	kParticleLoadFinishing,		// Waiting for the GL thread to apply the config, upload the texture and create buffers
+	kParticleLoadDone,
+	kParticleLoadFailed,
+	kParticleLoadCancelled
+};
+
+class ofxParticleLoader;
+
+// ------------------------------------------------------------------------
+// ofxParticleLoadRequest
+// ------------------------------------------------------------------------
+
+// One emitter being loaded.  prepare() reads the config and decodes its image on the loader
+// thread without touching the emitter, which may still be running.  finishStep() then
+// applies them one step per call on the thread which owns the context
+class ofxParticleLoadRequest
+{
+	
+	friend class ofxParticleLoader;
+	
+public:
+	
+	ofxParticleLoadRequest( const std::string& aFilename );
+	virtual ~ofxParticleLoadRequest() {}
+	
+	// One of kParticleLoadStates
+	int		getState();
+	bool	isDone();
+	bool	hasFailed();
+	
+	const std::string&	getFilename() const;
+	
+	// Stop loading, see ofxParticleLoader::cancel()
+	void	cancel();
+	
+protected:
+	
+	// Load the config and decode its image.  False on failure
+	bool			prepare();
+	
+	// Run the next GL step, true once there are none left
+	virtual bool	finishStep() = 0;
+	
+	std::string				filename;
+	ofxParticleEmitterConfigPtr	config;
+	ofxParticlePixelsPtr	pixels;		// Sprite image file decoded on the loader thread
+	
+	ofxParticleLoader*		loader;
+	int						state;		// Guarded by the loader's mutex
+};
+
+typedef Poco::SharedPtr<ofxParticleLoadRequest> ofxParticleLoadHandle;
+
+// Loads one kind of emitter.  Emitter provides finishLoad( step, config, pixels ), which is
+// called on the GL thread until it returns true
+template <class Emitter>
+class ofxParticleEmitterLoadRequest : public ofxParticleLoadRequest
+{
+	
+public:
+	
+	ofxParticleEmitterLoadRequest( Emitter* anEmitter, const std::string& aFilename ) 
+		: ofxParticleLoadRequest( aFilename ), emitter( anEmitter ), step( 0 ) {}
+	
+protected:
+	
+	bool	finishStep()	{ return emitter->finishLoad( step++, config, pixels ); }
+	
+	Emitter*	emitter;
+	int			step;
+};
+
+// ------------------------------------------------------------------------
+// ofxParticleLoader
+// ------------------------------------------------------------------------
+
+// Loads emitters on a background thread.  Reading and parsing the config and decoding its
+// image happen on the loader thread.  Applying the config, uploading the texture and
+// creating the vertex buffer happen in update(), which must be called every
+// frame from the thread which owns the GL context and stops once its time budget is spent
+class ofxParticleLoader : public Poco::Runnable
+{
+	
+public:
+	
+	ofxParticleLoader();
+	~ofxParticleLoader();
+	
+	static ofxParticleLoader&	getShared();
+	
+	// Queue a request, starting the loader thread if it is not running yet
+	void	load( const ofxParticleLoadHandle& request );
+	
+	// Finish loads for up to budget milliseconds.  At least one GL step is always run
+	// when one is waiting, so loading makes progress however small the budget
+	void	update( GLfloat budget = PARTICLE_LOADER_BUDGET );
+	
+	// Drop a request which has not finished yet, waiting for the loader thread if it is
+	// working on it.  Nothing more is done to its emitter afterwards
+	void	cancel( ofxParticleLoadRequest* request );
+	
+	// Requests not done, failed or cancelled yet
+	int		getPendingCount();
+	
+	void	run();
+	
+protected:
+	
+	int		getState( const ofxParticleLoadRequest* request );
+	
+	std::deque<ofxParticleLoadHandle>	queued;		// Waiting for the loader thread
+	std::deque<ofxParticleLoadHandle>	finishing;	// Waiting for the GL thread
+	ofxParticleLoadRequest*				preparing;	// On the loader thread right now
+	
+	Poco::FastMutex		mutex;
+	Poco::Event			wake;		// Set when requests are queued or the thread should stop
+	Poco::Event			prepared;	// Set whenever the loader thread finishes a request
+	Poco::Thread		thread;
+	bool				started, stopping;
+	
+	friend class ofxParticleLoadRequest;
+};
+
+#endif
@@ -0,0 +1,150 @@
+//
+// ofxParticleMappedFile.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "ofxParticleMappedFile.h"
+
+#ifndef TARGET_WIN32
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+// ------------------------------------------------------------------------
+// Lifecycle
+// ------------------------------------------------------------------------
+
+ofxParticleMappedFile::ofxParticleMappedFile()
+{
+	data = NULL;
+	size = 0;
+	
+#ifdef TARGET_WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#endif
+}
+
+ofxParticleMappedFile::~ofxParticleMappedFile()
+{
+	close();
+}
+
+// ------------------------------------------------------------------------
+// Mapping
+// ------------------------------------------------------------------------
+
+bool ofxParticleMappedFile::open( const std::string& path )
+{
+	close();
+	
+#ifdef TARGET_WIN32
+	// Sharing delete lets a recompiled file be renamed over this one while it is mapped
+	file = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( file == INVALID_HANDLE_VALUE )
+		return false;
+	
+	LARGE_INTEGER fileSize;
+	if ( !GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart == 0 )
+	{
+		close();
+		return false;
+	}
+	
+	mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+	if ( mapping == NULL )
+	{
+		close();
+		return false;
+	}
+	
+	data = (const unsigned char*)MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	if ( data == NULL )
+	{
+		close();
+		return false;
+	}
+	
+	size = (size_t)fileSize.QuadPart;
+#else
+	int fd = ::open( path.c_str(), O_RDONLY );
+	if ( fd < 0 )
+		return false;
+	
+	struct stat info;
+	if ( fstat( fd, &info ) != 0 || info.st_size == 0 )
+	{
+		::close( fd );
+		return false;
+	}
+	
+	// The mapping holds its own reference to the file, so the descriptor can go straight away
+	void* mapped = mmap( NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	::close( fd );
+	
+	if ( mapped == MAP_FAILED )
+		return false;
+	
+	data = (const unsigned char*)mapped;
+	size = (size_t)info.st_size;
+#endif
+	
+	return true;
+}
+
+void ofxParticleMappedFile::close()
+{
+#ifdef TARGET_WIN32
+	if ( data != NULL )
+		UnmapViewOfFile( data );
+	if ( mapping != NULL )
+		CloseHandle( mapping );
+	if ( file != INVALID_HANDLE_VALUE )
+		CloseHandle( file );
+	
+	mapping = NULL;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if ( data != NULL )
+		munmap( (void*)data, size );
+#endif
+	
+	data = NULL;
+	size = 0;
+}
+
+bool ofxParticleMappedFile::isOpen() const
+{
+	return data != NULL;
+}
+
+const unsigned char* ofxParticleMappedFile::getData() const
+{
+	return data;
+}
+
+size_t ofxParticleMappedFile::getSize() const
+{
+	return size;
+}
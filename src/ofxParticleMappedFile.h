@@ -0,0 +1,67 @@
+//
+// ofxParticleMappedFile.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef _OFX_PARTICLE_MAPPED_FILE
+#define _OFX_PARTICLE_MAPPED_FILE
+
+#include "ofMain.h"
+
+// ------------------------------------------------------------------------
+// ofxParticleMappedFile
+// ------------------------------------------------------------------------
+
+// Read only memory mapping of a whole file, so its contents can be used in place without
+// being read into a buffer first.  The mapping lasts until close() or destruction
+class ofxParticleMappedFile
+{
+	
+public:
+	
+	ofxParticleMappedFile();
+	~ofxParticleMappedFile();
+	
+	// Map the file at path, which is used as is rather than through ofToDataPath()
+	bool	open( const std::string& path );
+	void	close();
+	
+	bool					isOpen() const;
+	const unsigned char*	getData() const;
+	size_t					getSize() const;
+	
+private:
+	
+	// Mappings cannot be shared by copying
+	ofxParticleMappedFile( const ofxParticleMappedFile& );
+	ofxParticleMappedFile& operator=( const ofxParticleMappedFile& );
+	
+	const unsigned char*	data;
+	size_t					size;
+	
+#ifdef TARGET_WIN32
+	HANDLE					file;
+	HANDLE					mapping;
+#endif
+};
+
+#endif
@@ -0,0 +1,127 @@
+//
+// ofxParticlePackedVertex.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef _OFX_PARTICLE_PACKED_VERTEX
+#define _OFX_PARTICLE_PACKED_VERTEX
+
+#include "ofMain.h"
+
+// GL_HALF_FLOAT and GL_HALF_FLOAT_ARB share this value, older headers may have neither
+#define PARTICLE_GL_HALF_FLOAT		0x140B
+
+// ------------------------------------------------------------------------
+// Structures
+// ------------------------------------------------------------------------
+
+// IEEE 754 half precision float, 1 sign, 5 exponent and 10 mantissa bits
+typedef unsigned short ParticleHalf;
+
+// Compact form of PointSprite, 12 bytes instead of 28.  Positions are stored relative to
+// an origin near the particles, which keeps them within the precision of a half: about
+// 1/8 of a pixel up to 256 pixels away and 1/2 of a pixel up to 1024 pixels away
+typedef struct
+{
+	ParticleHalf	x, y;
+	ParticleHalf	size;
+	ParticleHalf	padding;		// Keeps the color on a 4 byte boundary
+	GLubyte			red, green, blue, alpha;
+} PackedPointSprite;
+
+// ------------------------------------------------------------------------
+// Conversions
+// ------------------------------------------------------------------------
+
+// Round a float to the nearest half, ties to even.  Values too large for a half become infinity
+static inline ParticleHalf ofxParticleFloatToHalf( float value )
+{
+	union { float f; unsigned int u; } bits;
+	bits.f = value;
+	
+	unsigned int sign = ( bits.u >> 16 ) & 0x8000;
+	unsigned int magnitude = bits.u & 0x7fffffff;
+	
+	// Infinity or NaN once past the largest half
+	if ( magnitude >= 0x47800000 )
+		return (ParticleHalf)( sign | ( magnitude > 0x7f800000 ? 0x7e00 : 0x7c00 ) );
+	
+	// Below the smallest normal half the value is a whole number of 2^-24 steps.  Adding 0.5
+	// lines those steps up with the float mantissa, and the FPU rounds them to even
+	if ( magnitude < 0x38800000 )
+	{
+		bits.u = magnitude;
+		bits.f += 0.5f;
+		return (ParticleHalf)( sign | ( bits.u - 0x3f000000 ) );
+	}
+	
+	// Rebias the exponent from 127 to 15 and round away the low 13 mantissa bits
+	magnitude += 0xc8000fff + ( ( magnitude >> 13 ) & 1 );
+	return (ParticleHalf)( sign | ( magnitude >> 13 ) );
+}
+
+static inline float ofxParticleHalfToFloat( ParticleHalf half )
+{
+	union { float f; unsigned int u; } bits;
+	
+	unsigned int sign = ( half & 0x8000 ) << 16;
+	unsigned int exponent = ( half >> 10 ) & 0x1f;
+	unsigned int mantissa = half & 0x3ff;
+	
+	if ( exponent == 0 )
+	{
+		bits.f = mantissa * ( 1.0f / 16777216.0f );
+		bits.u |= sign;
+	}
+	else if ( exponent == 31 )
+	{
+		bits.u = sign | 0x7f800000 | ( mantissa << 13 );
+	}
+	else
+	{
+		bits.u = sign | ( ( exponent + 112 ) << 23 ) | ( mantissa << 13 );
+	}
+	
+	return bits.f;
+}
+
+// Clamp a 0..1 color component to a byte, as glColor4f clamps float colors
+static inline GLubyte ofxParticleColorToByte( float value )
+{
+	if ( value <= 0.0f ) return 0;
+	if ( value >= 1.0f ) return 255;
+	return (GLubyte)( value * 255.0f + 0.5f );
+}
+
+static inline void ofxParticlePackSprite( PackedPointSprite* sprite, float x, float y, float size, float red, float green, float blue, float alpha )
+{
+	sprite->x = ofxParticleFloatToHalf( x );
+	sprite->y = ofxParticleFloatToHalf( y );
+	sprite->size = ofxParticleFloatToHalf( size );
+	sprite->padding = 0;
+	sprite->red = ofxParticleColorToByte( red );
+	sprite->green = ofxParticleColorToByte( green );
+	sprite->blue = ofxParticleColorToByte( blue );
+	sprite->alpha = ofxParticleColorToByte( alpha );
+}
+
+#endif
@@ -0,0 +1,262 @@
+//
+// ofxParticlePool.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "ofxParticlePool.h"
+#include <algorithm>
+
+// ------------------------------------------------------------------------
+// Aligned allocation
+// ------------------------------------------------------------------------
+
+void* ofxParticleAlignedAlloc( size_t size, size_t alignment )
+{
+	// Over-allocate so the returned pointer can be aligned, and stash the original
+	// pointer just in front of it so it can be handed back to free()
+	unsigned char* raw = (unsigned char*)malloc( size + alignment + sizeof( void* ) );
+	if ( raw == NULL )
+		return NULL;
+
+	size_t address = (size_t)( raw + sizeof( void* ) );
+	address = ( address + alignment - 1 ) & ~( alignment - 1 );
+
+	((void**)address)[-1] = raw;
+	return (void*)address;
+}
+
+void ofxParticleAlignedFree( void* ptr )
+{
+	if ( ptr != NULL )
+		free( ((void**)ptr)[-1] );
+}
+
+// ------------------------------------------------------------------------
+// Lifecycle
+// ------------------------------------------------------------------------
+
+ParticlePool::ParticlePool()
+{
+	capacity = paddedCapacity = count = 0;
+	dimensions = 2;
+	columnCount = 0;
+	block = NULL;
+	indices = NULL;
+
+	for ( int i = 0; i < kParticleColumnCount; i++ )
+		columns[i] = NULL;
+
+	bindColumns();
+}
+
+ParticlePool::~ParticlePool()
+{
+	release();
+}
+
+bool ParticlePool::allocate( int newCapacity, int newDimensions )
+{
+	release();
+
+	if ( newCapacity <= 0 )
+		return false;
+
+	// Round every column up so vectorized loops never have to handle a partial tail,
+	// and so each column starts on its own cache line
+	paddedCapacity = ( ( newCapacity + PARTICLE_POOL_PADDING - 1 ) / PARTICLE_POOL_PADDING ) * PARTICLE_POOL_PADDING;
+
+	size_t columnBytes = sizeof( GLfloat ) * paddedCapacity;
+	columnBytes = ( ( columnBytes + PARTICLE_POOL_ALIGNMENT - 1 ) / PARTICLE_POOL_ALIGNMENT ) * PARTICLE_POOL_ALIGNMENT;
+
+	// 2D particles leave out the z columns, so they are never copied around either
+	int newColumnCount = newDimensions == 3 ? kParticleColumnCount : PARTICLE_POOL_COLUMNS_2D;
+
+	block = ofxParticleAlignedAlloc( columnBytes * newColumnCount, PARTICLE_POOL_ALIGNMENT );
+	indices = (GLint*)ofxParticleAlignedAlloc( sizeof( GLint ) * paddedCapacity, PARTICLE_POOL_ALIGNMENT );
+	if ( block == NULL || indices == NULL )
+	{
+		release();
+		ofLog( OF_LOG_ERROR, "ParticlePool::allocate() - unable to allocate particle pool!" );
+		return false;
+	}
+
+	// Zero everything so the padding lanes hold harmless values
+	memset( block, 0, columnBytes * newColumnCount );
+
+	for ( int i = 0; i < newColumnCount; i++ )
+		columns[i] = (GLfloat*)( (unsigned char*)block + columnBytes * i );
+
+	bindColumns();
+
+	capacity = newCapacity;
+	count = 0;
+	dimensions = newDimensions;
+	columnCount = newColumnCount;
+
+	return true;
+}
+
+void ParticlePool::release()
+{
+	ofxParticleAlignedFree( block );
+	block = NULL;
+	ofxParticleAlignedFree( indices );
+	indices = NULL;
+
+	for ( int i = 0; i < kParticleColumnCount; i++ )
+		columns[i] = NULL;
+
+	bindColumns();
+
+	capacity = paddedCapacity = count = 0;
+	columnCount = 0;
+}
+
+bool ParticlePool::resize( int newCapacity )
+{
+	if ( newCapacity == capacity )
+		return true;
+
+	ParticlePool resized;
+	if ( !resized.allocate( newCapacity, dimensions ) )
+		return false;
+
+	int kept = count < newCapacity ? count : newCapacity;
+	for ( int i = 0; i < columnCount; i++ )
+		memcpy( resized.columns[i], columns[i], sizeof( GLfloat ) * kept );
+	resized.count = kept;
+
+	// The old block is freed when resized goes out of scope
+	swap( resized );
+
+	return true;
+}
+
+void ParticlePool::swap( ParticlePool& other )
+{
+	std::swap( capacity, other.capacity );
+	std::swap( paddedCapacity, other.paddedCapacity );
+	std::swap( count, other.count );
+	std::swap( dimensions, other.dimensions );
+	std::swap( columnCount, other.columnCount );
+	std::swap( block, other.block );
+	std::swap( indices, other.indices );
+
+	for ( int i = 0; i < kParticleColumnCount; i++ )
+		std::swap( columns[i], other.columns[i] );
+
+	bindColumns();
+	other.bindColumns();
+}
+
+void ParticlePool::bindColumns()
+{
+	positionX				= columns[kParticleColumnPositionX];
+	positionY				= columns[kParticleColumnPositionY];
+	directionX				= columns[kParticleColumnDirectionX];
+	directionY				= columns[kParticleColumnDirectionY];
+	startPosX				= columns[kParticleColumnStartPosX];
+	startPosY				= columns[kParticleColumnStartPosY];
+	colorRed				= columns[kParticleColumnColorRed];
+	colorGreen				= columns[kParticleColumnColorGreen];
+	colorBlue				= columns[kParticleColumnColorBlue];
+	colorAlpha				= columns[kParticleColumnColorAlpha];
+	deltaColorRed			= columns[kParticleColumnDeltaColorRed];
+	deltaColorGreen			= columns[kParticleColumnDeltaColorGreen];
+	deltaColorBlue			= columns[kParticleColumnDeltaColorBlue];
+	deltaColorAlpha			= columns[kParticleColumnDeltaColorAlpha];
+	radialAcceleration		= columns[kParticleColumnRadialAcceleration];
+	tangentialAcceleration	= columns[kParticleColumnTangentialAcceleration];
+	radius					= columns[kParticleColumnRadius];
+	radiusDelta				= columns[kParticleColumnRadiusDelta];
+	angle					= columns[kParticleColumnAngle];
+	degreesPerSecond		= columns[kParticleColumnDegreesPerSecond];
+	particleSize			= columns[kParticleColumnParticleSize];
+	particleSizeDelta		= columns[kParticleColumnParticleSizeDelta];
+	timeToLive				= columns[kParticleColumnTimeToLive];
+	previousX				= columns[kParticleColumnPreviousX];
+	previousY				= columns[kParticleColumnPreviousY];
+	previousSize			= columns[kParticleColumnPreviousSize];
+	spawnTime				= columns[kParticleColumnSpawnTime];
+	positionZ				= columns[kParticleColumnPositionZ];
+	directionZ				= columns[kParticleColumnDirectionZ];
+	startPosZ				= columns[kParticleColumnStartPosZ];
+	previousZ				= columns[kParticleColumnPreviousZ];
+}
+
+// ------------------------------------------------------------------------
+// Particle Management
+// ------------------------------------------------------------------------
+
+void ParticlePool::copy( int dst, int src )
+{
+	for ( int i = 0; i < columnCount; i++ )
+		columns[i][dst] = columns[i][src];
+}
+
+void ParticlePool::remove( int index )
+{
+	// Replace the particle with the last active one so the live particles stay packed
+	// at the start of every column
+	if ( index != count - 1 )
+		copy( index, count - 1 );
+	count--;
+}
+
+int ParticlePool::compact( int begin, int end, GLfloat threshold )
+{
+	// Gather the indices of the survivors first, so the columns can then be packed one at
+	// a time with a single streaming pass each
+	GLint* survivors = indices + begin;
+	int kept = 0;
+
+	for ( int i = begin; i < end; i++ )
+	{
+		survivors[kept] = i;
+		kept += timeToLive[i] > threshold ? 1 : 0;
+	}
+
+	if ( kept == end - begin )
+		return kept;
+
+	// Skip the leading survivors which are already in place
+	int first = 0;
+	while ( first < kept && survivors[first] == begin + first )
+		first++;
+
+	for ( int c = 0; c < columnCount; c++ )
+	{
+		GLfloat* column = columns[c];
+		for ( int k = first; k < kept; k++ )
+			column[begin + k] = column[survivors[k]];
+	}
+
+	return kept;
+}
+
+void ParticlePool::move( int dst, int src, int n )
+{
+	if ( dst == src || n <= 0 )
+		return;
+
+	for ( int c = 0; c < columnCount; c++ )
+		memmove( columns[c] + dst, columns[c] + src, sizeof( GLfloat ) * n );
+}
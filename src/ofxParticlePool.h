@@ -0,0 +1,155 @@
+//
+// ofxParticlePool.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef _OFX_PARTICLE_POOL
+#define _OFX_PARTICLE_POOL
+
+#include "ofMain.h"
+
+// ------------------------------------------------------------------------
+// Constants
+// ------------------------------------------------------------------------
+
+#define PARTICLE_POOL_ALIGNMENT		64		// Byte alignment of every column, one cache line
+#define PARTICLE_POOL_PADDING		8		// Column lengths are rounded up to a multiple of this
+
+// Indices of the columns held by a ParticlePool
+enum kParticleColumns
+{
+	kParticleColumnPositionX,
+	kParticleColumnPositionY,
+	kParticleColumnDirectionX,
+	kParticleColumnDirectionY,
+	kParticleColumnStartPosX,
+	kParticleColumnStartPosY,
+	kParticleColumnColorRed,
+	kParticleColumnColorGreen,
+	kParticleColumnColorBlue,
+	kParticleColumnColorAlpha,
+	kParticleColumnDeltaColorRed,
+	kParticleColumnDeltaColorGreen,
+	kParticleColumnDeltaColorBlue,
+	kParticleColumnDeltaColorAlpha,
+	kParticleColumnRadialAcceleration,
+	kParticleColumnTangentialAcceleration,
+	kParticleColumnRadius,
+	kParticleColumnRadiusDelta,
+	kParticleColumnAngle,
+	kParticleColumnDegreesPerSecond,
+	kParticleColumnParticleSize,
+	kParticleColumnParticleSizeDelta,
+	kParticleColumnTimeToLive,
+	kParticleColumnPreviousX,
+	kParticleColumnPreviousY,
+	kParticleColumnPreviousSize,
+	kParticleColumnSpawnTime,
+
+	// Only allocated for 3D particles, see ParticlePool::allocate()
+	kParticleColumnPositionZ,
+	kParticleColumnDirectionZ,
+	kParticleColumnStartPosZ,
+	kParticleColumnPreviousZ,
+
+	kParticleColumnCount
+};
+
+#define PARTICLE_POOL_COLUMNS_2D	kParticleColumnPositionZ	// Columns a 2D pool holds
+
+// ------------------------------------------------------------------------
+// Aligned allocation
+// ------------------------------------------------------------------------
+
+void*	ofxParticleAlignedAlloc( size_t size, size_t alignment );
+void	ofxParticleAlignedFree( void* ptr );
+
+// ------------------------------------------------------------------------
+// ParticlePool
+// ------------------------------------------------------------------------
+
+// Structure-of-arrays particle storage.  Every field of the Particle structure is kept
+// in its own contiguous column so that each pass of the update loop only streams the
+// memory it actually reads and writes.  All columns share a single aligned allocation
+// and are padded so vectorized loops may safely run up to paddedCapacity.
+class ParticlePool
+{
+
+public:
+
+	ParticlePool();
+	~ParticlePool();
+
+	// The z columns are only allocated for 3 dimensions, and are NULL otherwise
+	bool	allocate( int capacity, int dimensions = 2 );
+	void	release();
+
+	// Change the capacity keeping the first live particles that still fit, in order
+	bool	resize( int capacity );
+
+	void	copy( int dst, int src );
+	void	remove( int index );
+
+	// Pack the particles of [begin, end) whose timeToLive is above threshold at the start
+	// of the range, keeping their order, and return how many there are
+	int		compact( int begin, int end, GLfloat threshold = 0 );
+
+	// Move n particles from src to dst, the ranges may overlap
+	void	move( int dst, int src, int n );
+
+	GLint			capacity;			// Maximum number of particles the pool can hold
+	GLint			paddedCapacity;		// Capacity rounded up to PARTICLE_POOL_PADDING
+	GLint			count;				// Number of live particles, packed at the start of each column
+	GLint			dimensions;			// 2 or 3
+	GLint			columnCount;		// Number of columns allocated, the first of kParticleColumns
+
+	GLfloat*		columns[kParticleColumnCount];
+
+	// Named views onto the columns above
+	GLfloat			*positionX, *positionY;
+	GLfloat			*directionX, *directionY;
+	GLfloat			*startPosX, *startPosY;
+	GLfloat			*colorRed, *colorGreen, *colorBlue, *colorAlpha;
+	GLfloat			*deltaColorRed, *deltaColorGreen, *deltaColorBlue, *deltaColorAlpha;
+	GLfloat			*radialAcceleration, *tangentialAcceleration;
+	GLfloat			*radius, *radiusDelta;
+	GLfloat			*angle, *degreesPerSecond;
+	GLfloat			*particleSize, *particleSizeDelta;
+	GLfloat			*timeToLive;
+	GLfloat			*previousX, *previousY, *previousSize;	// State before the last fixed step, for interpolation
+	GLfloat			*spawnTime;		// Emitter time a particle was spawned at, only used by analytic evaluation
+	GLfloat			*positionZ, *directionZ, *startPosZ, *previousZ;	// 3D only
+
+protected:
+
+	void	bindColumns();
+	void	swap( ParticlePool& other );
+
+	void*			block;				// Single aligned allocation backing every column
+	GLint*			indices;			// Scratch space used by compact()
+
+private:
+
+	ParticlePool( const ParticlePool& );
+	ParticlePool& operator=( const ParticlePool& );
+};
+
+#endif
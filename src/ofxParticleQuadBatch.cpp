@@ -0,0 +1,211 @@
+//
+// ofxParticleQuadBatch.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "ofxParticleQuadBatch.h"
+#include <stddef.h>
+
+// Offsets of the PointSprite fields the batch reads
+#define SPRITE_X		0
+#define SPRITE_Y		1
+#define SPRITE_SIZE		2
+#define SPRITE_RED		3
+
+// ------------------------------------------------------------------------
+// Lifecycle
+// ------------------------------------------------------------------------
+
+ofxParticleQuadBatch::ofxParticleQuadBatch()
+{
+	quadCount = 0;
+}
+
+// ------------------------------------------------------------------------
+// Vertex building
+// ------------------------------------------------------------------------
+
+void ofxParticleQuadBatch::buildQuads( const void* sprites, size_t stride, int count, const ParticleTexRect& rect, 
+									  GLfloat offsetX, GLfloat offsetY, ParticleQuadVertex* out )
+{
+	const unsigned char* sprite = (const unsigned char*)sprites;
+	
+	for ( int i = 0; i < count; i++, sprite += stride, out += 4 )
+	{
+		const GLfloat* s = (const GLfloat*)sprite;
+		
+		// Sprites are drawn centered on their position, as the texture anchor used to do
+		GLfloat half = s[SPRITE_SIZE] * 0.5f;
+		GLfloat x = s[SPRITE_X] + offsetX;
+		GLfloat y = s[SPRITE_Y] + offsetY;
+		GLfloat x0 = x - half, x1 = x + half;
+		GLfloat y0 = y - half, y1 = y + half;
+		
+		GLubyte r = ofxParticleColorToByte( s[SPRITE_RED] );
+		GLubyte g = ofxParticleColorToByte( s[SPRITE_RED + 1] );
+		GLubyte b = ofxParticleColorToByte( s[SPRITE_RED + 2] );
+		GLubyte a = ofxParticleColorToByte( s[SPRITE_RED + 3] );
+		
+		out[0].x = x0; out[0].y = y0; out[0].u = rect.u0; out[0].v = rect.v0;
+		out[1].x = x1; out[1].y = y0; out[1].u = rect.u1; out[1].v = rect.v0;
+		out[2].x = x1; out[2].y = y1; out[2].u = rect.u1; out[2].v = rect.v1;
+		out[3].x = x0; out[3].y = y1; out[3].u = rect.u0; out[3].v = rect.v1;
+		
+		for ( int k = 0; k < 4; k++ )
+		{
+			out[k].red = r;
+			out[k].green = g;
+			out[k].blue = b;
+			out[k].alpha = a;
+		}
+	}
+}
+
+void ofxParticleQuadBatch::buildQuads( const PackedPointSprite* sprites, int count, const ParticleTexRect& rect, 
+									  GLfloat offsetX, GLfloat offsetY, ParticleQuadVertex* out )
+{
+	for ( int i = 0; i < count; i++, out += 4 )
+	{
+		const PackedPointSprite& s = sprites[i];
+		
+		GLfloat x = ofxParticleHalfToFloat( s.x ) + offsetX;
+		GLfloat y = ofxParticleHalfToFloat( s.y ) + offsetY;
+		GLfloat half = ofxParticleHalfToFloat( s.size ) * 0.5f;
+		
+		out[0].x = x - half; out[0].y = y - half; out[0].u = rect.u0; out[0].v = rect.v0;
+		out[1].x = x + half; out[1].y = y - half; out[1].u = rect.u1; out[1].v = rect.v0;
+		out[2].x = x + half; out[2].y = y + half; out[2].u = rect.u1; out[2].v = rect.v1;
+		out[3].x = x - half; out[3].y = y + half; out[3].u = rect.u0; out[3].v = rect.v1;
+		
+		for ( int k = 0; k < 4; k++ )
+		{
+			out[k].red = s.red;
+			out[k].green = s.green;
+			out[k].blue = s.blue;
+			out[k].alpha = s.alpha;
+		}
+	}
+}
+
+ParticleTexRect ofxParticleQuadBatch::getTexRect( const ofTextureData& texData )
+{
+	// tex_t and tex_u are the extent of the image in texture coordinates, which is in
+	// pixels for rectangle textures and below 1 for padded power of two textures
+	ParticleTexRect rect;
+	rect.u0 = 0.0f;
+	rect.u1 = texData.tex_t;
+	rect.v0 = texData.bFlipTexture ? texData.tex_u : 0.0f;
+	rect.v1 = texData.bFlipTexture ? 0.0f : texData.tex_u;
+	return rect;
+}
+
+void ofxParticleQuadBatch::build( const void* sprites, size_t stride, int count, const ParticleTexRect& rect )
+{
+	clear();
+	append( sprites, stride, count, rect );
+}
+
+void ofxParticleQuadBatch::build( const PackedPointSprite* sprites, int count, const ParticleTexRect& rect )
+{
+	clear();
+	append( sprites, count, rect );
+}
+
+void ofxParticleQuadBatch::clear()
+{
+	quadCount = 0;
+}
+
+ParticleQuadVertex* ofxParticleQuadBatch::grow( int count )
+{
+	int first = quadCount;
+	quadCount += count;
+	
+	// The vertices are kept between frames, so this only allocates while the batch grows
+	if ( (int)quadVertices.size() < quadCount * 4 )
+		quadVertices.resize( quadCount * 4 );
+	
+	return &quadVertices[first * 4];
+}
+
+void ofxParticleQuadBatch::append( const void* sprites, size_t stride, int count, const ParticleTexRect& rect, GLfloat offsetX, GLfloat offsetY )
+{
+	if ( count > 0 )
+		buildQuads( sprites, stride, count, rect, offsetX, offsetY, grow( count ) );
+}
+
+void ofxParticleQuadBatch::append( const PackedPointSprite* sprites, int count, const ParticleTexRect& rect, GLfloat offsetX, GLfloat offsetY )
+{
+	if ( count > 0 )
+		buildQuads( sprites, count, rect, offsetX, offsetY, grow( count ) );
+}
+
+int ofxParticleQuadBatch::getQuadCount() const
+{
+	return quadCount;
+}
+
+const ParticleQuadVertex* ofxParticleQuadBatch::getVertices() const
+{
+	return quadVertices.empty() ? NULL : &quadVertices[0];
+}
+
+// ------------------------------------------------------------------------
+// Render
+// ------------------------------------------------------------------------
+
+void ofxParticleQuadBatch::draw( const ofTextureData& texData, ofxParticleStreamBuffer* stream )
+{
+	if ( quadCount <= 0 )
+		return;
+	
+	// Attribute pointers are offsets into the buffer when streaming, addresses otherwise
+	const char* base = (const char*)&quadVertices[0];
+	if ( stream != NULL )
+		base = (const char*)stream->upload( base, sizeof( ParticleQuadVertex ) * quadCount * 4 );
+	
+	glEnable( texData.textureTarget );
+	glBindTexture( texData.textureTarget, (GLuint)texData.textureID );
+	
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+	glEnableClientState( GL_COLOR_ARRAY );
+	
+	glVertexPointer( 2, GL_FLOAT, sizeof( ParticleQuadVertex ), base + offsetof( ParticleQuadVertex, x ) );
+	glTexCoordPointer( 2, GL_FLOAT, sizeof( ParticleQuadVertex ), base + offsetof( ParticleQuadVertex, u ) );
+	glColorPointer( 4, GL_UNSIGNED_BYTE, sizeof( ParticleQuadVertex ), base + offsetof( ParticleQuadVertex, red ) );
+	
+	glDrawArrays( GL_QUADS, 0, quadCount * 4 );
+	
+	if ( stream != NULL )
+		glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	
+	glDisableClientState( GL_COLOR_ARRAY );
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+	
+	glBindTexture( texData.textureTarget, 0 );
+	glDisable( texData.textureTarget );
+	
+	// The color array leaves the current color undefined
+	glColor4f( 1.0f, 1.0f, 1.0f, 1.0f );
+}
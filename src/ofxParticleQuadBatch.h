@@ -0,0 +1,104 @@
+//
+// ofxParticleQuadBatch.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef _OFX_PARTICLE_QUAD_BATCH
+#define _OFX_PARTICLE_QUAD_BATCH
+
+#include "ofMain.h"
+#include "ofxParticleStreamBuffer.h"
+#include "ofxParticlePackedVertex.h"
+
+// ------------------------------------------------------------------------
+// Structures
+// ------------------------------------------------------------------------
+
+// One corner of a particle quad, interleaved so a single array feeds every attribute
+typedef struct
+{
+	GLfloat		x, y;
+	GLfloat		u, v;
+	GLubyte		red, green, blue, alpha;
+} ParticleQuadVertex;
+
+// Texture coordinates covering a sprite
+typedef struct
+{
+	GLfloat		u0, v0;
+	GLfloat		u1, v1;
+} ParticleTexRect;
+
+// ------------------------------------------------------------------------
+// ofxParticleQuadBatch
+// ------------------------------------------------------------------------
+
+// Expands point sprites into textured quads centered on each sprite and draws all of
+// them with a single draw call.  Building the vertices does not touch GL, so it can be
+// run and checked without a context
+class ofxParticleQuadBatch
+{
+	
+public:
+	
+	ofxParticleQuadBatch();
+	
+	// Write 4 vertices per sprite to out, which must have room for count * 4 of them.
+	// Sprites are the PointSprite layout used by the emitters: x, y, size, then a float
+	// RGBA color which is clamped to 0..1.  The offset is added to every position
+	static void		buildQuads( const void* sprites, size_t stride, int count, const ParticleTexRect& rect, 
+							   GLfloat offsetX, GLfloat offsetY, ParticleQuadVertex* out );
+	
+	// Same as above for packed sprites, whose positions are relative to their packing origin
+	static void		buildQuads( const PackedPointSprite* sprites, int count, const ParticleTexRect& rect, 
+							   GLfloat offsetX, GLfloat offsetY, ParticleQuadVertex* out );
+	
+	// Texture coordinates covering the whole of a texture, following its flip flag
+	static ParticleTexRect	getTexRect( const ofTextureData& texData );
+	
+	// Replace the contents of the batch with count sprites
+	void	build( const void* sprites, size_t stride, int count, const ParticleTexRect& rect );
+	void	build( const PackedPointSprite* sprites, int count, const ParticleTexRect& rect );
+	
+	// Add sprites after those already in the batch, so several emitters sharing a texture
+	// can be drawn together
+	void	clear();
+	void	append( const void* sprites, size_t stride, int count, const ParticleTexRect& rect, GLfloat offsetX = 0, GLfloat offsetY = 0 );
+	void	append( const PackedPointSprite* sprites, int count, const ParticleTexRect& rect, GLfloat offsetX = 0, GLfloat offsetY = 0 );
+	
+	// Draw the batch with the texture bound, the blend function is left to the caller.
+	// The vertices are sent through stream when given, otherwise from client memory
+	void	draw( const ofTextureData& texData, ofxParticleStreamBuffer* stream = NULL );
+	
+	int							getQuadCount() const;
+	const ParticleQuadVertex*	getVertices() const;
+	
+protected:
+	
+	// Make room for count more quads and return where they go
+	ParticleQuadVertex*	grow( int count );
+	
+	std::vector<ParticleQuadVertex>	quadVertices;
+	int								quadCount;
+};
+
+#endif
@@ -0,0 +1,153 @@
+//
+// ofxParticleRandom.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "ofxParticleRandom.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+	#define PARTICLE_RANDOM_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+// ------------------------------------------------------------------------
+// Lifecycle
+// ------------------------------------------------------------------------
+
+ofxParticleRandom::ofxParticleRandom()
+{
+	seed( 0x9E3779B9 );
+}
+
+ofxParticleRandom::ofxParticleRandom( unsigned int value )
+{
+	seed( value );
+}
+
+void ofxParticleRandom::seed( unsigned int value )
+{
+	initialSeed = value;
+
+	// Expand the seed into the sixteen state words with splitmix32, which never leaves
+	// a stream with an all zero state
+	unsigned int z = value;
+	for ( int word = 0; word < 4; word++ )
+	{
+		for ( int stream = 0; stream < 4; stream++ )
+		{
+			z += 0x9E3779B9;
+			unsigned int t = z;
+			t = ( t ^ ( t >> 16 ) ) * 0x85EBCA6B;
+			t = ( t ^ ( t >> 13 ) ) * 0xC2B2AE35;
+			state[word][stream] = t ^ ( t >> 16 );
+		}
+	}
+
+	bufferIndex = 4;
+}
+
+unsigned int ofxParticleRandom::getSeed() const
+{
+	return initialSeed;
+}
+
+// ------------------------------------------------------------------------
+// Generation
+// ------------------------------------------------------------------------
+
+void ofxParticleRandom::refill()
+{
+	step( buffer );
+	bufferIndex = 0;
+}
+
+void ofxParticleRandom::fillMinus1To1( float* out, int count )
+{
+	// Hand out what is left of the current block first so the sequence continues
+	while ( count > 0 && bufferIndex < 4 )
+	{
+		*out++ = buffer[bufferIndex++];
+		count--;
+	}
+
+	while ( count >= 4 )
+	{
+		step( out );
+		out += 4;
+		count -= 4;
+	}
+
+	while ( count > 0 )
+	{
+		*out++ = nextMinus1To1();
+		count--;
+	}
+}
+
+void ofxParticleRandom::step( float* out )
+{
+	// The top 24 bits of each result become a float in [0, 2) which is shifted to [-1, 1)
+	const float scale = 1.0f / 8388608.0f;
+
+#ifdef PARTICLE_RANDOM_SSE2
+
+	__m128i s0 = _mm_loadu_si128( (const __m128i*)state[0] );
+	__m128i s1 = _mm_loadu_si128( (const __m128i*)state[1] );
+	__m128i s2 = _mm_loadu_si128( (const __m128i*)state[2] );
+	__m128i s3 = _mm_loadu_si128( (const __m128i*)state[3] );
+
+	__m128i result = _mm_add_epi32( s0, s3 );
+	__m128i t = _mm_slli_epi32( s1, 9 );
+
+	s2 = _mm_xor_si128( s2, s0 );
+	s3 = _mm_xor_si128( s3, s1 );
+	s1 = _mm_xor_si128( s1, s2 );
+	s0 = _mm_xor_si128( s0, s3 );
+	s2 = _mm_xor_si128( s2, t );
+	s3 = _mm_or_si128( _mm_slli_epi32( s3, 11 ), _mm_srli_epi32( s3, 21 ) );
+
+	_mm_storeu_si128( (__m128i*)state[0], s0 );
+	_mm_storeu_si128( (__m128i*)state[1], s1 );
+	_mm_storeu_si128( (__m128i*)state[2], s2 );
+	_mm_storeu_si128( (__m128i*)state[3], s3 );
+
+	__m128 values = _mm_cvtepi32_ps( _mm_srli_epi32( result, 8 ) );
+	_mm_storeu_ps( out, _mm_sub_ps( _mm_mul_ps( values, _mm_set1_ps( scale ) ), _mm_set1_ps( 1.0f ) ) );
+
+#else
+
+	for ( int i = 0; i < 4; i++ )
+	{
+		unsigned int result = state[0][i] + state[3][i];
+		unsigned int t = state[1][i] << 9;
+
+		state[2][i] ^= state[0][i];
+		state[3][i] ^= state[1][i];
+		state[1][i] ^= state[2][i];
+		state[0][i] ^= state[3][i];
+		state[2][i] ^= t;
+		state[3][i] = ( state[3][i] << 11 ) | ( state[3][i] >> 21 );
+
+		out[i] = (float)( result >> 8 ) * scale - 1.0f;
+	}
+
+#endif
+}
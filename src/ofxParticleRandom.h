@@ -0,0 +1,76 @@
+//
+// ofxParticleRandom.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef _OFX_PARTICLE_RANDOM
+#define _OFX_PARTICLE_RANDOM
+
+#include "ofMain.h"
+
+// ------------------------------------------------------------------------
+// ofxParticleRandom
+// ------------------------------------------------------------------------
+
+// Seedable xoshiro128+ generator owned by each emitter.  Four independent streams are
+// advanced together so a block of four values costs one vector step, and single values
+// are served from that block.  The sequence only depends on the seed, whether values
+// are drawn one at a time or in bulk and whichever instruction set produced them.
+class ofxParticleRandom
+{
+
+public:
+
+	ofxParticleRandom();
+	ofxParticleRandom( unsigned int seed );
+
+	void			seed( unsigned int seed );
+	unsigned int	getSeed() const;
+
+	// Return a random value in [-1, 1)
+	inline float nextMinus1To1()
+	{
+		if ( bufferIndex == 4 )
+			refill();
+		return buffer[bufferIndex++];
+	}
+
+	// Return a random value in [0, 1)
+	inline float next0To1()
+	{
+		return nextMinus1To1() * 0.5f + 0.5f;
+	}
+
+	// Write count values in [-1, 1) to out, continuing the same sequence as nextMinus1To1()
+	void			fillMinus1To1( float* out, int count );
+
+protected:
+
+	void			refill();
+	void			step( float* out );
+
+	unsigned int	initialSeed;
+	unsigned int	state[4][4];		// state[word][stream]
+	float			buffer[4];			// Values of the last step not yet handed out
+	int				bufferIndex;
+};
+
+#endif
@@ -0,0 +1,232 @@
+//
+// ofxParticleStreamBuffer.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "ofxParticleStreamBuffer.h"
+
+// ------------------------------------------------------------------------
+// Lifecycle
+// ------------------------------------------------------------------------
+
+ofxParticleStreamBuffer::ofxParticleStreamBuffer()
+{
+	bufferID = 0;
+	mode = kParticleStreamOrphan;
+	segmentSize = 0;
+	segment = 0;
+	lastUploadBytes = 0;
+	totalUploadBytes = 0;
+	
+#ifdef PARTICLE_STREAM_RING_SUPPORTED
+	for ( int i = 0; i < PARTICLE_STREAM_SEGMENTS; i++ )
+		fences[i] = 0;
+#endif
+}
+
+ofxParticleStreamBuffer::~ofxParticleStreamBuffer()
+{
+	release();
+}
+
+void ofxParticleStreamBuffer::release()
+{
+#ifdef PARTICLE_STREAM_RING_SUPPORTED
+	for ( int i = 0; i < PARTICLE_STREAM_SEGMENTS; i++ )
+	{
+		if ( fences[i] != 0 )
+			glDeleteSync( fences[i] );
+		fences[i] = 0;
+	}
+#endif
+	
+	if ( bufferID != 0 )
+		glDeleteBuffers( 1, &bufferID );
+	bufferID = 0;
+	
+	segmentSize = 0;
+	segment = 0;
+}
+
+void ofxParticleStreamBuffer::setMode( int newMode )
+{
+	if ( newMode == mode )
+		return;
+	
+	// The two modes lay the buffer out differently, so start again
+	release();
+	mode = newMode;
+}
+
+int ofxParticleStreamBuffer::getMode() const
+{
+	return mode;
+}
+
+GLuint ofxParticleStreamBuffer::getID() const
+{
+	return bufferID;
+}
+
+size_t ofxParticleStreamBuffer::getLastUploadBytes() const
+{
+	return lastUploadBytes;
+}
+
+double ofxParticleStreamBuffer::getTotalUploadBytes() const
+{
+	return totalUploadBytes;
+}
+
+bool ofxParticleStreamBuffer::isRingAvailable()
+{
+#ifdef PARTICLE_STREAM_RING_SUPPORTED
+	static int available = -1;
+	
+	if ( available < 0 )
+	{
+		// Both are core from OpenGL 3.2, or may be offered as extensions before that
+		const char* version = (const char*)glGetString( GL_VERSION );
+		const char* extensions = (const char*)glGetString( GL_EXTENSIONS );
+		
+		int major = 0, minor = 0;
+		if ( version != NULL )
+			sscanf( version, "%d.%d", &major, &minor );
+		
+		bool core = major > 3 || ( major == 3 && minor >= 2 );
+		bool extension = extensions != NULL && strstr( extensions, "GL_ARB_sync" ) != NULL && strstr( extensions, "GL_ARB_map_buffer_range" ) != NULL;
+		
+		available = ( core || extension ) ? 1 : 0;
+		
+		if ( !available )
+			ofLog( OF_LOG_NOTICE, "ofxParticleStreamBuffer - fences not available, ring buffers will orphan instead" );
+	}
+	
+	return available == 1;
+#else
+	return false;
+#endif
+}
+
+// ------------------------------------------------------------------------
+// Upload
+// ------------------------------------------------------------------------
+
+size_t ofxParticleStreamBuffer::upload( const void* data, size_t bytes )
+{
+	if ( bufferID == 0 )
+		glGenBuffers( 1, &bufferID );
+	
+	glBindBuffer( GL_ARRAY_BUFFER, bufferID );
+	
+	lastUploadBytes = bytes;
+	totalUploadBytes += bytes;
+	
+	if ( bytes == 0 )
+		return 0;
+	
+	if ( mode == kParticleStreamRing && isRingAvailable() )
+		return uploadRing( data, bytes );
+	
+	return uploadOrphan( data, bytes );
+}
+
+void ofxParticleStreamBuffer::allocate( size_t bytes )
+{
+	bool ring = mode == kParticleStreamRing && isRingAvailable();
+	
+	if ( reserve( bytes ) )
+	{
+		glBufferData( GL_ARRAY_BUFFER, segmentSize * ( ring ? PARTICLE_STREAM_SEGMENTS : 1 ), NULL, GL_STREAM_DRAW );
+		segment = PARTICLE_STREAM_SEGMENTS - 1;
+	}
+	
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+bool ofxParticleStreamBuffer::reserve( size_t bytes )
+{
+	if ( bytes <= segmentSize )
+		return false;
+	
+	release();
+	glGenBuffers( 1, &bufferID );
+	glBindBuffer( GL_ARRAY_BUFFER, bufferID );
+	
+	segmentSize = ( ( bytes + PARTICLE_STREAM_GRANULARITY - 1 ) / PARTICLE_STREAM_GRANULARITY ) * PARTICLE_STREAM_GRANULARITY;
+	return true;
+}
+
+size_t ofxParticleStreamBuffer::uploadOrphan( const void* data, size_t bytes )
+{
+	reserve( bytes );
+	
+	// Respecifying the storage detaches the old contents, which the driver keeps until the
+	// draws using them are done, so the copy below never has to wait for the GPU
+	glBufferData( GL_ARRAY_BUFFER, segmentSize, NULL, GL_STREAM_DRAW );
+	glBufferSubData( GL_ARRAY_BUFFER, 0, bytes, data );
+	
+	return 0;
+}
+
+size_t ofxParticleStreamBuffer::uploadRing( const void* data, size_t bytes )
+{
+#ifdef PARTICLE_STREAM_RING_SUPPORTED
+	if ( reserve( bytes ) )
+	{
+		glBufferData( GL_ARRAY_BUFFER, segmentSize * PARTICLE_STREAM_SEGMENTS, NULL, GL_STREAM_DRAW );
+		segment = PARTICLE_STREAM_SEGMENTS - 1;
+	}
+	else
+	{
+		// Every command issued since the last upload may read the last segment, so
+		// fence them before moving on
+		fences[segment] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	}
+	
+	segment = ( segment + 1 ) % PARTICLE_STREAM_SEGMENTS;
+	
+	// With three segments this fence is two frames old and has nearly always signalled
+	if ( fences[segment] != 0 )
+	{
+		while ( glClientWaitSync( fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 ) == GL_TIMEOUT_EXPIRED ) {}
+		glDeleteSync( fences[segment] );
+		fences[segment] = 0;
+	}
+	
+	size_t offset = segmentSize * segment;
+	
+	void* target = glMapBufferRange( GL_ARRAY_BUFFER, offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT );
+	if ( target == NULL )
+	{
+		glBufferSubData( GL_ARRAY_BUFFER, offset, bytes, data );
+		return offset;
+	}
+	
+	memcpy( target, data, bytes );
+	glUnmapBuffer( GL_ARRAY_BUFFER );
+	
+	return offset;
+#else
+	return uploadOrphan( data, bytes );
+#endif
+}
@@ -0,0 +1,109 @@
+//
+// ofxParticleStreamBuffer.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef _OFX_PARTICLE_STREAM_BUFFER
+#define _OFX_PARTICLE_STREAM_BUFFER
+
+#include "ofMain.h"
+
+// Ring mode needs mapped buffer ranges and fences, which OpenGL ES 1 does not have
+#if defined( GL_MAP_UNSYNCHRONIZED_BIT ) && defined( GL_SYNC_GPU_COMMANDS_COMPLETE )
+	#define PARTICLE_STREAM_RING_SUPPORTED
+#endif
+
+#define PARTICLE_STREAM_SEGMENTS	3			// Uploads in flight in ring mode
+#define PARTICLE_STREAM_GRANULARITY	65536		// Buffer sizes are rounded up to a multiple of this
+
+// ------------------------------------------------------------------------
+// Structures
+// ------------------------------------------------------------------------
+
+// How a stream buffer avoids waiting on draws still reading the previous upload
+enum kParticleStreamModes
+{
+	kParticleStreamOrphan,		// Give the driver a fresh buffer every upload with glBufferData( NULL )
+	kParticleStreamRing			// Write each upload to the next of several segments, guarded by fences
+};
+
+// ------------------------------------------------------------------------
+// ofxParticleStreamBuffer
+// ------------------------------------------------------------------------
+
+// A vertex buffer which is rewritten every frame.  Only the bytes passed to upload() are
+// sent, so a buffer sized for every particle costs nothing extra while few are alive.
+// The buffer object is created by the first upload, which must happen with a GL context
+class ofxParticleStreamBuffer
+{
+	
+public:
+	
+	ofxParticleStreamBuffer();
+	~ofxParticleStreamBuffer();
+	
+	// Ring mode falls back to orphaning when the context has no fences or mapped ranges
+	void	setMode( int mode );
+	int		getMode() const;
+	
+	// Copy bytes of data into the buffer and leave it bound to GL_ARRAY_BUFFER.  Returns the
+	// offset of the data within the buffer, to be used as the attribute pointer base
+	size_t	upload( const void* data, size_t bytes );
+	
+	// Create the buffer with room for uploads of up to bytes, so the first upload does not
+	// have to.  Leaves no buffer bound
+	void	allocate( size_t bytes );
+	
+	void	release();
+	
+	GLuint	getID() const;
+	
+	size_t	getLastUploadBytes() const;		// Bytes sent by the last upload
+	double	getTotalUploadBytes() const;	// Bytes sent since the buffer was created
+	
+protected:
+	
+	bool	reserve( size_t bytes );
+	size_t	uploadOrphan( const void* data, size_t bytes );
+	size_t	uploadRing( const void* data, size_t bytes );
+	
+	static bool	isRingAvailable();
+	
+	GLuint		bufferID;
+	int			mode;
+	size_t		segmentSize;		// Bytes per segment, the whole buffer in orphan mode
+	int			segment;			// Segment written by the last ring upload
+	
+#ifdef PARTICLE_STREAM_RING_SUPPORTED
+	GLsync		fences[PARTICLE_STREAM_SEGMENTS];	// Signalled once the draws reading each segment are done
+#endif
+	
+	size_t		lastUploadBytes;
+	double		totalUploadBytes;
+	
+private:
+	
+	ofxParticleStreamBuffer( const ofxParticleStreamBuffer& );
+	ofxParticleStreamBuffer& operator=( const ofxParticleStreamBuffer& );
+};
+
+#endif
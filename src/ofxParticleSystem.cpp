@@ -0,0 +1,327 @@
+//
+// ofxParticleSystem.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "ofxParticleSystem.h"
+#include <algorithm>
+
+// Orders emitter indices from the most live particles to the fewest
+class ParticleCountGreater
+{
+	
+public:
+	
+	ParticleCountGreater( const std::vector<ofxParticleEmitter*>& emitters ) : emitters( emitters ) {}
+	
+	bool operator()( int a, int b ) const
+	{
+		return emitters[a]->particleCount > emitters[b]->particleCount;
+	}
+	
+protected:
+	
+	const std::vector<ofxParticleEmitter*>& emitters;
+};
+
+// ------------------------------------------------------------------------
+// Lifecycle
+// ------------------------------------------------------------------------
+
+ofxParticleSystem::ofxParticleSystem()
+{
+	threadPool = &ofxParticleThreadPool::getShared();
+	atlas = NULL;
+	batching = false;
+	
+	culling = kParticleCullOff;
+	viewRect[0] = viewRect[1] = viewRect[2] = viewRect[3] = 0;
+	culled = 0;
+}
+
+ofxParticleSystem::~ofxParticleSystem()
+{
+	clear();
+	
+	if ( atlas != NULL )
+		delete atlas;
+}
+
+// ------------------------------------------------------------------------
+// Emitters
+// ------------------------------------------------------------------------
+
+ofxParticleEmitter* ofxParticleSystem::loadEmitter( const std::string& filename, int storageMode )
+{
+	ofxParticleEmitter* emitter = new ofxParticleEmitter();
+	emitter->setStorageMode( storageMode );
+	
+	if ( !emitter->loadFromXml( filename ) )
+	{
+		ofLog( OF_LOG_ERROR, "ofxParticleSystem::loadEmitter() - failed to load " + filename );
+		delete emitter;
+		return NULL;
+	}
+	
+	addEmitter( emitter, true );
+	return emitter;
+}
+
+void ofxParticleSystem::addEmitter( ofxParticleEmitter* emitter, bool isOwned )
+{
+	if ( emitter == NULL )
+		return;
+	
+	emitters.push_back( emitter );
+	owned.push_back( isOwned );
+}
+
+void ofxParticleSystem::removeEmitter( ofxParticleEmitter* emitter )
+{
+	for ( size_t i = 0; i < emitters.size(); i++ )
+	{
+		if ( emitters[i] != emitter )
+			continue;
+		
+		if ( owned[i] )
+			delete emitter;
+		
+		emitters.erase( emitters.begin() + i );
+		owned.erase( owned.begin() + i );
+		return;
+	}
+}
+
+void ofxParticleSystem::clear()
+{
+	for ( size_t i = 0; i < emitters.size(); i++ )
+	{
+		if ( owned[i] )
+			delete emitters[i];
+	}
+	
+	emitters.clear();
+	owned.clear();
+	order.clear();
+}
+
+int ofxParticleSystem::getEmitterCount() const
+{
+	return (int)emitters.size();
+}
+
+ofxParticleEmitter* ofxParticleSystem::getEmitter( int index ) const
+{
+	if ( index < 0 || index >= (int)emitters.size() )
+		return NULL;
+	
+	return emitters[index];
+}
+
+int ofxParticleSystem::getParticleCount() const
+{
+	int total = 0;
+	for ( size_t i = 0; i < emitters.size(); i++ )
+		total += emitters[i]->particleCount;
+	
+	return total;
+}
+
+void ofxParticleSystem::setThreadPool( ofxParticleThreadPool* threads )
+{
+	threadPool = threads;
+}
+
+// ------------------------------------------------------------------------
+// Update
+// ------------------------------------------------------------------------
+
+void ofxParticleSystem::update()
+{
+	// One measurement for the whole system so every emitter advances by the same time
+	GLfloat aDelta = lastUpdate.elapsed() / 1000000.0f;
+	lastUpdate.update();
+	
+	update( aDelta );
+}
+
+void ofxParticleSystem::update( GLfloat aDelta )
+{
+	if ( emitters.empty() )
+		return;
+	
+	// Swap in reloaded configs here, since the jobs below run away from the GL thread
+	for ( size_t i = 0; i < emitters.size(); i++ )
+		emitters[i]->checkForReload();
+	
+	// Hand out the largest emitters first, each free thread then takes the largest one
+	// left, which keeps the threads finishing at about the same time
+	order.resize( emitters.size() );
+	for ( size_t i = 0; i < order.size(); i++ )
+		order[i] = (int)i;
+	std::stable_sort( order.begin(), order.end(), ParticleCountGreater( emitters ) );
+	
+	ParticleSystemUpdateJob job( this, aDelta );
+	
+	// Emitters with a parallel update of their own fall back to updating serially here,
+	// since the pool is already busy with the system
+	if ( threadPool != NULL )
+		threadPool->run( &job, (int)emitters.size() );
+	else
+		for ( size_t i = 0; i < emitters.size(); i++ )
+			job.run( (int)i );
+}
+
+ParticleSystemUpdateJob::ParticleSystemUpdateJob( ofxParticleSystem* system, GLfloat aDelta ) : system( system ), delta( aDelta )
+{
+}
+
+void ParticleSystemUpdateJob::run( int index )
+{
+	system->emitters[system->order[index]]->advance( delta );
+}
+
+// ------------------------------------------------------------------------
+// Render
+// ------------------------------------------------------------------------
+
+bool ofxParticleSystem::buildAtlas( int pageSize )
+{
+	if ( atlas != NULL )
+		delete atlas;
+	atlas = new ofxParticleAtlas( pageSize );
+	
+	for ( size_t i = 0; i < emitters.size(); i++ )
+		atlas->add( emitters[i]->getTexture() );
+	
+	if ( !atlas->build() )
+		return false;
+	
+	ofTextureData texData;
+	ParticleTexRect rect;
+	
+	for ( size_t i = 0; i < emitters.size(); i++ )
+	{
+		if ( atlas->getRegion( emitters[i]->getTexture(), texData, rect ) )
+			emitters[i]->setTextureRegion( texData, rect );
+	}
+	
+	return true;
+}
+
+void ofxParticleSystem::setBatching( bool enabled )
+{
+	batching = enabled;
+}
+
+void ofxParticleSystem::setCulling( int mode )
+{
+	culling = mode;
+}
+
+void ofxParticleSystem::setViewRect( GLfloat left, GLfloat top, GLfloat width, GLfloat height )
+{
+	viewRect[0] = left;
+	viewRect[1] = top;
+	viewRect[2] = width;
+	viewRect[3] = height;
+}
+
+int ofxParticleSystem::getCulledCount() const
+{
+	return culled;
+}
+
+void ofxParticleSystem::findVisible( int x, int y )
+{
+	visible.clear();
+	
+	ParticleFrustum frustum;
+	if ( culling == kParticleCullFrustum )
+		frustum = ofxParticleGetFrustum();
+	
+	for ( size_t i = 0; i < emitters.size(); i++ )
+	{
+		ofxParticleEmitter* e = emitters[i];
+		
+		if ( culling == kParticleCullRect && !e->isVisible( viewRect[0], viewRect[1], viewRect[2], viewRect[3], x, y ) )
+			continue;
+		if ( culling == kParticleCullFrustum && !e->isVisible( frustum, x, y ) )
+			continue;
+		
+		visible.push_back( e );
+	}
+	
+	culled = (int)( emitters.size() - visible.size() );
+}
+
+bool ofxParticleSystem::canBatch( const ofxParticleEmitter* a, const ofxParticleEmitter* b ) const
+{
+	return a->texture != NULL && b->texture != NULL && 
+		a->textureData.textureID == b->textureData.textureID && 
+		a->textureData.textureTarget == b->textureData.textureTarget && 
+		a->blendFuncSource == b->blendFuncSource && 
+		a->blendFuncDestination == b->blendFuncDestination;
+}
+
+void ofxParticleSystem::draw( int x, int y )
+{
+	// Drawing stays on the calling thread, which owns the GL context.  Emitters out of view
+	// are left out first, which also lets the emitters either side of them batch together
+	findVisible( x, y );
+	
+	if ( !batching )
+	{
+		for ( size_t i = 0; i < visible.size(); i++ )
+			visible[i]->draw( x, y );
+		return;
+	}
+	
+	// Only neighbouring emitters are merged so the draw order, which blending depends on, is kept
+	size_t first = 0;
+	while ( first < visible.size() )
+	{
+		size_t last = first + 1;
+		while ( last < visible.size() && canBatch( visible[first], visible[last] ) )
+			last++;
+		
+		if ( last - first == 1 )
+		{
+			visible[first]->draw( x, y );
+		}
+		else
+		{
+			batch.clear();
+			for ( size_t i = first; i < last; i++ )
+				visible[i]->appendQuads( batch, x, y );
+			
+			ofxParticleEmitter* e = visible[first];
+			
+			glEnable( GL_BLEND );
+			glBlendFunc( e->blendFuncSource, e->blendFuncDestination );
+			batch.draw( e->textureData, &batchStream );
+			glDisable( GL_BLEND );
+		}
+		
+		first = last;
+	}
+}
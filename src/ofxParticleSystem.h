@@ -0,0 +1,150 @@
+//
+// ofxParticleSystem.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef _OFX_PARTICLE_SYSTEM
+#define _OFX_PARTICLE_SYSTEM
+
+#include "ofMain.h"
+#include "ofxParticleEmitter.h"
+#include "ofxParticleThreadPool.h"
+#include "ofxParticleAtlas.h"
+#include "Poco/Timestamp.h"
+
+// ------------------------------------------------------------------------
+// Structures
+// ------------------------------------------------------------------------
+
+// How draw() leaves out emitters which are out of view, from their bounds
+enum kParticleCullModes
+{
+	kParticleCullOff,			// Every emitter is drawn
+	kParticleCullRect,			// Emitters outside the rect given to setViewRect() are left out
+	kParticleCullFrustum		// Emitters outside the frustum of the GL matrices at draw() are left out
+};
+
+// ------------------------------------------------------------------------
+// ofxParticleSystem
+// ------------------------------------------------------------------------
+
+class ofxParticleSystem;
+
+// Updates the emitters of a system, one emitter per item
+class ParticleSystemUpdateJob : public ofxParticleJob
+{
+	
+public:
+	
+	ParticleSystemUpdateJob( ofxParticleSystem* system, GLfloat aDelta );
+	void	run( int index );
+	
+protected:
+	
+	ofxParticleSystem*	system;
+	GLfloat				delta;
+};
+
+// Owns a set of independent emitters, updates all of them across a thread pool in a
+// single call and then draws them together.  Emitters are handed to the threads from
+// the most particles to the fewest so a few large emitters do not end up queued behind
+// many small ones
+class ofxParticleSystem
+{
+	
+	friend class ParticleSystemUpdateJob;
+	
+public:
+	
+	ofxParticleSystem();
+	~ofxParticleSystem();
+	
+	// Create an emitter from a config file and add it to the system, NULL on failure
+	ofxParticleEmitter*	loadEmitter( const std::string& filename, int storageMode = kParticleStorageArray );
+	
+	// Add an emitter created elsewhere.  When owned is true the system deletes it
+	void	addEmitter( ofxParticleEmitter* emitter, bool owned = false );
+	
+	// Take an emitter out of the system, deleting it if the system owns it
+	void	removeEmitter( ofxParticleEmitter* emitter );
+	void	clear();
+	
+	int					getEmitterCount() const;
+	ofxParticleEmitter*	getEmitter( int index ) const;
+	
+	// Total live particles across every emitter
+	int		getParticleCount() const;
+	
+	// Threads used to update the emitters, the shared pool by default.  NULL updates
+	// every emitter on the calling thread
+	void	setThreadPool( ofxParticleThreadPool* threads );
+	
+	// Pack the sprites of every emitter into shared atlas pages and point the emitters at
+	// them.  Call again after adding emitters with new sprites.  Needs a GL context
+	bool	buildAtlas( int pageSize = PARTICLE_ATLAS_PAGE_SIZE );
+	
+	// Draw runs of consecutive emitters which share a texture and blend mode as one batch of
+	// quads instead of one draw per emitter.  Most useful together with buildAtlas()
+	void	setBatching( bool enabled );
+	
+	// Leave emitters which are wholly out of view out of draw(), one of kParticleCullModes.
+	// The view rect is in the coordinates draw() draws into, which include its x, y offset.
+	// Culled emitters are still updated, so they are right when they come back into view
+	void	setCulling( int mode );
+	void	setViewRect( GLfloat left, GLfloat top, GLfloat width, GLfloat height );
+	
+	// Emitters the last draw() left out
+	int		getCulledCount() const;
+	
+	void	update();
+	void	update( GLfloat aDelta );
+	void	draw( int x = 0, int y = 0 );
+	
+protected:
+	
+	std::vector<ofxParticleEmitter*>	emitters;	// In the order they were added, which is also the draw order
+	std::vector<bool>					owned;		// Whether the system deletes the emitter at the same index
+	std::vector<int>					order;		// Emitter indices by descending particle count, rebuilt every update
+	
+	ofxParticleThreadPool*	threadPool;
+	Poco::Timestamp			lastUpdate;
+	
+	ofxParticleAtlas*		atlas;
+	bool					batching;
+	ofxParticleQuadBatch	batch;			// Reused by every run of batched emitters
+	ofxParticleStreamBuffer	batchStream;
+	
+	int						culling;		// One of kParticleCullModes
+	GLfloat					viewRect[4];	// Left, top, width and height
+	int						culled;
+	std::vector<ofxParticleEmitter*>	visible;	// Emitters the current draw() draws, in order
+	
+private:
+	
+	ofxParticleSystem( const ofxParticleSystem& );
+	ofxParticleSystem& operator=( const ofxParticleSystem& );
+	
+	bool	canBatch( const ofxParticleEmitter* a, const ofxParticleEmitter* b ) const;
+	void	findVisible( int x, int y );
+};
+
+#endif
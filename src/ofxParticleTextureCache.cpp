@@ -0,0 +1,215 @@
+//
+// ofxParticleTextureCache.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "ofxParticleTextureCache.h"
+#include <fstream>
+
+// ------------------------------------------------------------------------
+// Lifecycle
+// ------------------------------------------------------------------------
+
+ofxParticleTextureCache& ofxParticleTextureCache::getShared()
+{
+	static ofxParticleTextureCache shared;
+	return shared;
+}
+
+unsigned long long ofxParticleTextureCache::hash( const void* data, size_t size )
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	unsigned long long h = 14695981039346656037ULL;
+	
+	for ( size_t i = 0; i < size; i++ )
+	{
+		h ^= bytes[i];
+		h *= 1099511628211ULL;
+	}
+	
+	return h;
+}
+
+// ------------------------------------------------------------------------
+// Images
+// ------------------------------------------------------------------------
+
+ofImage* ofxParticleTextureCache::acquire( const std::string& filename )
+{
+	std::string path = ofToDataPath( filename, true );
+	
+	// The same path again, nothing to read
+	std::map<std::string, ofImage*>::iterator named = byPath.find( path );
+	if ( named != byPath.end() )
+	{
+		retain( named->second );
+		return named->second;
+	}
+	
+	// Read the file once to hash it, which is far cheaper than decoding it
+	std::ifstream file( path.c_str(), std::ios::in | std::ios::binary );
+	if ( !file )
+	{
+		ofLog( OF_LOG_ERROR, "ofxParticleTextureCache::acquire() - unable to read " + path );
+		return NULL;
+	}
+	
+	std::vector<char> contents( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+	unsigned long long contentHash = hash( contents.empty() ? NULL : &contents[0], contents.size() );
+	
+	for ( size_t i = 0; i < entries.size(); i++ )
+	{
+		if ( entries[i].contentHash == contentHash )
+		{
+			byPath[path] = entries[i].image;
+			entries[i].references++;
+			return entries[i].image;
+		}
+	}
+	
+	ofImage* image = new ofImage();
+	if ( !image->loadImage( path ) )
+	{
+		ofLog( OF_LOG_ERROR, "ofxParticleTextureCache::acquire() - unable to decode " + path );
+		delete image;
+		return NULL;
+	}
+	
+	image->setUseTexture( true );
+	image->setAnchorPercent( 0.5f, 0.5f );
+	
+	Entry entry;
+	entry.image = image;
+	entry.path = path;
+	entry.contentHash = contentHash;
+	entry.references = 1;
+	entries.push_back( entry );
+	
+	byPath[path] = image;
+	
+	return image;
+}
+
+ofImage* ofxParticleTextureCache::acquire( const unsigned char* pixels, int width, int height, int channels, const std::string& filename )
+{
+	if ( pixels == NULL || width <= 0 || height <= 0 )
+		return NULL;
+	
+	std::string path = filename != "" ? ofToDataPath( filename, true ) : "";
+	
+	if ( path != "" )
+	{
+		std::map<std::string, ofImage*>::iterator named = byPath.find( path );
+		if ( named != byPath.end() )
+		{
+			retain( named->second );
+			return named->second;
+		}
+	}
+	
+	unsigned long long contentHash = hash( pixels, (size_t)width * height * channels );
+	
+	for ( size_t i = 0; i < entries.size(); i++ )
+	{
+		ofImage* image = entries[i].image;
+		if ( entries[i].contentHash == contentHash && image->width == width && image->height == height )
+		{
+			if ( path != "" )
+				byPath[path] = image;
+			entries[i].references++;
+			return image;
+		}
+	}
+	
+	int type = OF_IMAGE_COLOR_ALPHA;
+	if ( channels == 1 )
+		type = OF_IMAGE_GRAYSCALE;
+	else if ( channels == 3 )
+		type = OF_IMAGE_COLOR;
+	
+	// setFromPixels() copies the pixels, so they are never written through
+	ofImage* image = new ofImage();
+	image->setUseTexture( true );
+	image->setFromPixels( (unsigned char*)pixels, width, height, type );
+	image->setAnchorPercent( 0.5f, 0.5f );
+	
+	Entry entry;
+	entry.image = image;
+	entry.path = path;
+	entry.contentHash = contentHash;
+	entry.references = 1;
+	entries.push_back( entry );
+	
+	if ( path != "" )
+		byPath[path] = image;
+	
+	return image;
+}
+
+void ofxParticleTextureCache::retain( ofImage* image )
+{
+	Entry* entry = find( image );
+	if ( entry != NULL )
+		entry->references++;
+}
+
+void ofxParticleTextureCache::release( ofImage* image )
+{
+	for ( size_t i = 0; i < entries.size(); i++ )
+	{
+		if ( entries[i].image != image )
+			continue;
+		
+		if ( --entries[i].references > 0 )
+			return;
+		
+		// Forget every name the image was known by
+		std::map<std::string, ofImage*>::iterator it = byPath.begin();
+		while ( it != byPath.end() )
+		{
+			if ( it->second == image )
+				byPath.erase( it++ );
+			else
+				++it;
+		}
+		
+		delete image;
+		entries.erase( entries.begin() + i );
+		return;
+	}
+}
+
+int ofxParticleTextureCache::getImageCount() const
+{
+	return (int)entries.size();
+}
+
+ofxParticleTextureCache::Entry* ofxParticleTextureCache::find( ofImage* image )
+{
+	for ( size_t i = 0; i < entries.size(); i++ )
+	{
+		if ( entries[i].image == image )
+			return &entries[i];
+	}
+	
+	return NULL;
+}
@@ -0,0 +1,82 @@
+//
+// ofxParticleTextureCache.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef _OFX_PARTICLE_TEXTURE_CACHE
+#define _OFX_PARTICLE_TEXTURE_CACHE
+
+#include "ofMain.h"
+
+// ------------------------------------------------------------------------
+// ofxParticleTextureCache
+// ------------------------------------------------------------------------
+
+// Process wide store of the sprite images used by emitters.  Images are looked up by
+// path and then by a hash of the file contents, so every emitter naming the same file,
+// or a copy of it under another name, shares one decoded image and one texture.  Images
+// are reference counted and deleted when the last emitter releases them.  Loading creates
+// textures, so the cache is only used from the thread which owns the GL context
+class ofxParticleTextureCache
+{
+	
+public:
+	
+	static ofxParticleTextureCache&	getShared();
+	
+	// Return the image for filename, loading it if no emitter holds it yet.  NULL when the
+	// file cannot be read.  Every image acquired must be handed back to release()
+	ofImage*	acquire( const std::string& filename );
+	
+	// Same as above for pixels already in memory, 1, 3 or 4 bytes each with rows from the
+	// top.  Images are matched by a hash of the pixels.  When the pixels were decoded from a
+	// file, passing its name lets later requests for that file find them
+	ofImage*	acquire( const unsigned char* pixels, int width, int height, int channels, const std::string& filename = "" );
+	
+	// Take an extra reference on an image the cache already holds
+	void		retain( ofImage* image );
+	
+	void		release( ofImage* image );
+	
+	// Number of distinct images held
+	int			getImageCount() const;
+	
+	// 64 bit FNV-1a hash used to recognize identical contents
+	static unsigned long long	hash( const void* data, size_t size );
+	
+protected:
+	
+	typedef struct
+	{
+		ofImage*			image;
+		std::string			path;		// Absolute path the image was first loaded from
+		unsigned long long	contentHash;
+		int					references;
+	} Entry;
+	
+	Entry*	find( ofImage* image );
+	
+	std::vector<Entry>						entries;
+	std::map<std::string, ofImage*>			byPath;		// Every path an image has been requested under
+};
+
+#endif
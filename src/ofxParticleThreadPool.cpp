@@ -0,0 +1,249 @@
+//
+// ofxParticleThreadPool.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "ofxParticleThreadPool.h"
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <unistd.h>
+#endif
+
+static int processorCount()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	return MAX( 1, (int)info.dwNumberOfProcessors );
+#else
+	long n = sysconf( _SC_NPROCESSORS_ONLN );
+	return n > 0 ? (int)n : 1;
+#endif
+}
+
+// ------------------------------------------------------------------------
+// Worker
+// ------------------------------------------------------------------------
+
+ofxParticleThreadPool::Worker::Worker( ofxParticleThreadPool* owner, int slot ) : owner( owner ), slot( slot )
+{
+}
+
+void ofxParticleThreadPool::Worker::run()
+{
+	for ( ;; )
+	{
+		wake.wait();
+
+		if ( owner->quit )
+			return;
+
+		owner->work( slot );
+		owner->leave();
+	}
+}
+
+// ------------------------------------------------------------------------
+// Queue
+// ------------------------------------------------------------------------
+
+ofxParticleThreadPool::Queue::Queue() : begin( 0 ), end( 0 )
+{
+}
+
+// ------------------------------------------------------------------------
+// Lifecycle
+// ------------------------------------------------------------------------
+
+ofxParticleThreadPool::ofxParticleThreadPool( int workerCount )
+{
+	job = NULL;
+	remaining = active = 0;
+	quit = false;
+
+	if ( workerCount <= 0 )
+		workerCount = processorCount() - 1;
+
+	queues.push_back( new Queue() );
+
+	for ( int i = 0; i < workerCount; i++ )
+	{
+		queues.push_back( new Queue() );
+
+		Worker* worker = new Worker( this, i + 1 );
+		workers.push_back( worker );
+		worker->thread.start( *worker );
+	}
+}
+
+ofxParticleThreadPool::~ofxParticleThreadPool()
+{
+	quit = true;
+
+	for ( size_t i = 0; i < workers.size(); i++ )
+		workers[i]->wake.set();
+
+	for ( size_t i = 0; i < workers.size(); i++ )
+	{
+		workers[i]->thread.join();
+		delete workers[i];
+	}
+	workers.clear();
+
+	for ( size_t i = 0; i < queues.size(); i++ )
+		delete queues[i];
+	queues.clear();
+}
+
+ofxParticleThreadPool& ofxParticleThreadPool::getShared()
+{
+	static ofxParticleThreadPool shared;
+	return shared;
+}
+
+int ofxParticleThreadPool::getThreadCount() const
+{
+	return (int)workers.size() + 1;
+}
+
+// ------------------------------------------------------------------------
+// Jobs
+// ------------------------------------------------------------------------
+
+void ofxParticleThreadPool::run( ofxParticleJob* newJob, int newCount )
+{
+	if ( newCount <= 0 )
+		return;
+
+	// Single items, a pool without workers and nested calls all run right here
+	if ( newCount == 1 || workers.empty() || !busy.tryLock() )
+	{
+		for ( int i = 0; i < newCount; i++ )
+			newJob->run( i );
+		return;
+	}
+
+	// Only wake as many workers as there are items for them, and split the items evenly
+	// between those workers and the caller.  No worker is in work() between jobs, so the
+	// queues can be filled before any of them is woken
+	int wakeCount = MIN( (int)workers.size(), newCount - 1 );
+	{
+		Poco::FastMutex::ScopedLock lock( mutex );
+		job = newJob;
+		remaining = newCount;
+		active = wakeCount;
+	}
+
+	for ( int i = 0; i <= wakeCount; i++ )
+	{
+		Poco::FastMutex::ScopedLock lock( queues[i]->mutex );
+		queues[i]->begin = newCount * i / ( wakeCount + 1 );
+		queues[i]->end = newCount * ( i + 1 ) / ( wakeCount + 1 );
+	}
+
+	for ( int i = 0; i < wakeCount; i++ )
+		workers[i]->wake.set();
+
+	work( 0 );
+	done.wait();
+
+	{
+		Poco::FastMutex::ScopedLock lock( mutex );
+		job = NULL;
+	}
+
+	busy.unlock();
+}
+
+bool ofxParticleThreadPool::claim( int slot, int& index )
+{
+	Queue* queue = queues[slot];
+	Poco::FastMutex::ScopedLock lock( queue->mutex );
+
+	if ( queue->begin >= queue->end )
+		return false;
+
+	index = queue->begin++;
+	return true;
+}
+
+bool ofxParticleThreadPool::steal( int slot )
+{
+	// Look through the other queues, starting after this one so the thieves spread out
+	for ( size_t i = 1; i < queues.size(); i++ )
+	{
+		Queue* victim = queues[( slot + i ) % queues.size()];
+		int begin, end;
+		{
+			Poco::FastMutex::ScopedLock lock( victim->mutex );
+			if ( victim->begin >= victim->end )
+				continue;
+
+			// Take the back half, rounded up so a single item left can be stolen too
+			end = victim->end;
+			begin = victim->end = victim->begin + ( victim->end - victim->begin ) / 2;
+		}
+
+		// Nothing else fills this queue during a job, and it is empty
+		Queue* queue = queues[slot];
+		Poco::FastMutex::ScopedLock lock( queue->mutex );
+		queue->begin = begin;
+		queue->end = end;
+		return true;
+	}
+
+	return false;
+}
+
+void ofxParticleThreadPool::finish()
+{
+	Poco::FastMutex::ScopedLock lock( mutex );
+
+	if ( --remaining == 0 && active == 0 )
+		done.set();
+}
+
+void ofxParticleThreadPool::leave()
+{
+	Poco::FastMutex::ScopedLock lock( mutex );
+
+	if ( --active == 0 && remaining == 0 )
+		done.set();
+}
+
+void ofxParticleThreadPool::work( int slot )
+{
+	int index;
+
+	for ( ;; )
+	{
+		while ( claim( slot, index ) )
+		{
+			job->run( index );
+			finish();
+		}
+
+		if ( !steal( slot ) )
+			return;
+	}
+}
@@ -0,0 +1,123 @@
+//
+// ofxParticleThreadPool.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef _OFX_PARTICLE_THREAD_POOL
+#define _OFX_PARTICLE_THREAD_POOL
+
+#include "ofMain.h"
+#include "Poco/Thread.h"
+#include "Poco/Runnable.h"
+#include "Poco/Event.h"
+#include "Poco/Mutex.h"
+
+// ------------------------------------------------------------------------
+// ofxParticleJob
+// ------------------------------------------------------------------------
+
+// A batch of independent work items, run( index ) is called once for every item
+class ofxParticleJob
+{
+
+public:
+
+	virtual ~ofxParticleJob() {}
+	virtual void run( int index ) = 0;
+};
+
+// ------------------------------------------------------------------------
+// ofxParticleThreadPool
+// ------------------------------------------------------------------------
+
+// Persistent worker threads which share the items of one job at a time.  Each thread
+// starts with an even run of the items in its own queue and takes them from the front.
+// A thread whose queue is empty steals the back half of another thread's queue, so
+// uneven items balance out across the threads.  The calling thread works on the job too.
+class ofxParticleThreadPool
+{
+
+public:
+
+	// Pass 0 to start one worker per core besides the calling thread
+	ofxParticleThreadPool( int workerCount = 0 );
+	~ofxParticleThreadPool();
+
+	// Pool shared by every emitter
+	static ofxParticleThreadPool&	getShared();
+
+	// Number of threads which work on a job, including the caller
+	int		getThreadCount() const;
+
+	// Run every item of job and return once all of them are finished.  If the pool is
+	// already busy, for example when called from inside another job, the items are run
+	// on the calling thread instead
+	void	run( ofxParticleJob* job, int count );
+
+protected:
+
+	class Worker : public Poco::Runnable
+	{
+	public:
+		Worker( ofxParticleThreadPool* owner, int slot );
+		void run();
+
+		ofxParticleThreadPool*	owner;
+		int						slot;		// Queue of the worker, the caller has queue 0
+		Poco::Event				wake;
+		Poco::Thread			thread;
+	};
+
+	// Items begin to end of the job which one thread has still to run
+	class Queue
+	{
+	public:
+		Queue();
+
+		Poco::FastMutex		mutex;
+		int					begin, end;
+	};
+
+	bool	claim( int slot, int& index );
+	bool	steal( int slot );
+	void	finish();
+	void	leave();
+	void	work( int slot );
+
+	std::vector<Worker*>	workers;
+	std::vector<Queue*>		queues;		// One per thread, the caller's first
+
+	Poco::FastMutex		busy;			// Held by the thread running a job
+	Poco::FastMutex		mutex;			// Protects remaining and active
+	Poco::Event			done;			// Set when the job is finished and every worker has left it
+
+	ofxParticleJob*		job;
+	int					remaining;		// Items not finished yet
+	int					active;			// Woken workers which are still in work()
+	bool				quit;
+
+private:
+
+	ofxParticleThreadPool( const ofxParticleThreadPool& );
+	ofxParticleThreadPool& operator=( const ofxParticleThreadPool& );
+};
+
+#endif
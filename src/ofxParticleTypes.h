@@ -0,0 +1,84 @@
+//
+// ofxParticleTypes.h
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#ifndef _OFX_PARTICLE_TYPES
+#define _OFX_PARTICLE_TYPES
+
+#include "ofMain.h"
+
+// ------------------------------------------------------------------------
+// Structures
+// ------------------------------------------------------------------------
+
+// Structure that defines the elements which make up a color
+typedef struct {
+	GLfloat red;
+	GLfloat green;
+	GLfloat blue;
+	GLfloat alpha;
+} Color4f;
+
+// Structure that defines a vector using x and y
+typedef struct {
+	GLfloat x;
+	GLfloat y;
+} Vector2f;
+
+// Structure that defines a vector using x, y and z
+typedef struct {
+	GLfloat x;
+	GLfloat y;
+	GLfloat z;
+} Vector3f;
+
+// Structure that holds the location and size for each point sprite
+typedef struct 
+{
+	GLfloat x;
+	GLfloat y;
+	GLfloat size;
+	Color4f color;
+} PointSprite;
+
+// ------------------------------------------------------------------------
+// Macros
+// ------------------------------------------------------------------------
+
+// Macro which converts degrees into radians
+#define DEGREES_TO_RADIANS(__ANGLE__) ((__ANGLE__) / 180.0 * PI)
+
+// ------------------------------------------------------------------------
+// Inline functions
+// ------------------------------------------------------------------------
+
+// Return a Color4f structure populated with 1.0's
+static const Color4f Color4fOnes = {1.0f, 1.0f, 1.0f, 1.0f};
+
+// Return a Color4f structure populated with the color values passed in
+static inline Color4f Color4fMake(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+	Color4f c; c.red = red; c.green = green; c.blue = blue; c.alpha = alpha;
+	return c;
+}
+
+#endif
@@ -0,0 +1,209 @@
+//
+// kernelsTest.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Runs the kernels of every instruction set built in and supported here on the same
+// randomly filled pool as the scalar kernels, and checks they agree to within the
+// tolerances stated in ofxParticleKernels.h.  Exits with 1 when any value is outside
+
+#include "ofxParticleKernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#define TEST_PARTICLES			1003		// Not a multiple of any vector width, so the tails run too
+#define TEST_ANGLE_RANGE		3000.0f		// "A few thousand radians" the polynomial holds for
+#define TEST_RELATIVE_ERROR		1e-5f		// Gravity mode, relative to the scalar value
+#define TEST_SINCOS_ERROR		2e-6f		// Radial mode sin and cos, absolute
+#define TEST_MAX_REPORTS		20
+
+static int failures = 0;
+
+// ------------------------------------------------------------------------
+// Helpers
+// ------------------------------------------------------------------------
+
+static GLfloat randomRange( GLfloat low, GLfloat high )
+{
+	return low + ( high - low ) * ( rand() / (GLfloat)RAND_MAX );
+}
+
+static void fill( ParticlePool& pool )
+{
+	for ( int i = 0; i < pool.capacity; i++ )
+	{
+		for ( int c = 0; c < pool.columnCount; c++ )
+			pool.columns[c][i] = randomRange( -1.0f, 1.0f );
+		
+		pool.startPosX[i] = randomRange( 0.0f, 1024.0f );
+		pool.startPosY[i] = randomRange( 0.0f, 768.0f );
+		pool.startPosZ[i] = randomRange( -512.0f, 512.0f );
+		
+		// Some particles sit on their start position, where gravity mode has no radial direction
+		bool atStart = i % 17 == 0;
+		pool.positionX[i] = atStart ? pool.startPosX[i] : randomRange( 0.0f, 1024.0f );
+		pool.positionY[i] = atStart ? pool.startPosY[i] : randomRange( 0.0f, 768.0f );
+		pool.positionZ[i] = atStart ? pool.startPosZ[i] : randomRange( -512.0f, 512.0f );
+		
+		pool.directionX[i] = randomRange( -300.0f, 300.0f );
+		pool.directionY[i] = randomRange( -300.0f, 300.0f );
+		pool.directionZ[i] = randomRange( -300.0f, 300.0f );
+		pool.radialAcceleration[i] = randomRange( -200.0f, 200.0f );
+		pool.tangentialAcceleration[i] = randomRange( -200.0f, 200.0f );
+		
+		pool.colorRed[i] = randomRange( 0.0f, 1.0f );
+		pool.colorGreen[i] = randomRange( 0.0f, 1.0f );
+		pool.colorBlue[i] = randomRange( 0.0f, 1.0f );
+		pool.colorAlpha[i] = randomRange( 0.0f, 1.0f );
+		pool.particleSize[i] = randomRange( 0.0f, 64.0f );
+		pool.particleSizeDelta[i] = randomRange( -32.0f, 32.0f );
+		pool.timeToLive[i] = randomRange( 0.1f, 5.0f );
+		
+		pool.radius[i] = randomRange( 0.0f, 300.0f );
+		pool.radiusDelta[i] = randomRange( -50.0f, 50.0f );
+		pool.angle[i] = randomRange( -TEST_ANGLE_RANGE, TEST_ANGLE_RANGE );
+		pool.degreesPerSecond[i] = randomRange( -10.0f, 10.0f );
+	}
+	pool.count = pool.capacity;
+}
+
+static void copyPool( ParticlePool& dst, const ParticlePool& src )
+{
+	for ( int c = 0; c < src.columnCount; c++ )
+		memcpy( dst.columns[c], src.columns[c], src.paddedCapacity * sizeof( GLfloat ) );
+	dst.count = src.count;
+}
+
+static void check( const char* isa, const char* what, int i, GLfloat value, GLfloat expected, GLfloat tolerance )
+{
+	if ( fabsf( value - expected ) <= tolerance )
+		return;
+	
+	if ( failures < TEST_MAX_REPORTS )
+		printf( "%s: %s of particle %d is %.9g, scalar %.9g, tolerance %g\n", isa, what, i, value, expected, tolerance );
+	failures++;
+}
+
+// ------------------------------------------------------------------------
+// Tests
+// ------------------------------------------------------------------------
+
+static void testIntegrate( const ParticleKernels* kernels, const ParticleKernels* scalar, const ParticlePool& start )
+{
+	ParticleKernelParams params;
+	params.delta = 1.0f / 60.0f;
+	params.gravityX = 12.0f;
+	params.gravityY = -98.0f;
+	params.gravityZ = 30.0f;
+	params.sourceX = 512.0f;
+	params.sourceY = 384.0f;
+	params.sourceZ = -20.0f;
+	params.minRadius = 10.0f;
+	
+	ParticlePool expected, actual;
+	expected.allocate( start.capacity, 3 );
+	actual.allocate( start.capacity, 3 );
+	
+	for ( int features = 0; features < kParticleFeatureCombinations; features++ )
+	{
+		copyPool( expected, start );
+		copyPool( actual, start );
+		
+		scalar->integrate[features]( &expected, 0, start.count, &params );
+		kernels->integrate[features]( &actual, 0, start.count, &params );
+		
+		for ( int c = 0; c < start.columnCount; c++ )
+		{
+			char what[64];
+			sprintf( what, "column %d with features 0x%02x", c, features );
+			
+			bool position = c == kParticleColumnPositionX || c == kParticleColumnPositionY || c == kParticleColumnPositionZ;
+			
+			for ( int i = 0; i < start.count; i++ )
+			{
+				GLfloat e = expected.columns[c][i];
+				
+				// Radial positions are the source less sin and cos times the radius, rounded
+				GLfloat tolerance = TEST_RELATIVE_ERROR * MAX( fabsf( e ), 1.0f );
+				if ( ( features & kParticleFeatureRadial ) && position )
+					tolerance = TEST_SINCOS_ERROR * fabsf( expected.radius[i] ) + FLT_EPSILON * fabsf( e );
+				
+				check( kernels->name, what, i, actual.columns[c][i], e, tolerance );
+			}
+		}
+	}
+}
+
+static void testSinCos( const ParticleKernels* kernels, const ParticleKernels* scalar )
+{
+	GLfloat angles[TEST_PARTICLES];
+	GLfloat sines[TEST_PARTICLES], cosines[TEST_PARTICLES];
+	GLfloat expectedSines[TEST_PARTICLES], expectedCosines[TEST_PARTICLES];
+	
+	// Include the quadrant boundaries, where the reduction switches polynomials
+	for ( int i = 0; i < TEST_PARTICLES; i++ )
+		angles[i] = i < 64 ? ( i - 32 ) * (GLfloat)PI * 0.25f : randomRange( -TEST_ANGLE_RANGE, TEST_ANGLE_RANGE );
+	
+	scalar->sinCos( angles, expectedSines, expectedCosines, TEST_PARTICLES );
+	kernels->sinCos( angles, sines, cosines, TEST_PARTICLES );
+	
+	for ( int i = 0; i < TEST_PARTICLES; i++ )
+	{
+		check( kernels->name, "sin", i, sines[i], expectedSines[i], TEST_SINCOS_ERROR );
+		check( kernels->name, "cos", i, cosines[i], expectedCosines[i], TEST_SINCOS_ERROR );
+	}
+}
+
+// ------------------------------------------------------------------------
+// Main
+// ------------------------------------------------------------------------
+
+int main()
+{
+	srand( 1 );
+	
+	ParticlePool start;
+	if ( !start.allocate( TEST_PARTICLES, 3 ) )
+		return 1;
+	fill( start );
+	
+	const ParticleKernels* scalar = ofxParticleGetKernels( kParticleKernelScalar );
+	
+	for ( int isa = 0; isa < kParticleKernelISACount; isa++ )
+	{
+		const ParticleKernels* kernels = ofxParticleGetKernels( isa );
+		if ( kernels == NULL )
+			continue;
+		
+		int before = failures;
+		testIntegrate( kernels, scalar, start );
+		testSinCos( kernels, scalar );
+		printf( "%-8s %s\n", kernels->name, failures == before ? "ok" : "FAILED" );
+	}
+	
+	if ( failures > 0 )
+		printf( "%d values outside tolerance\n", failures );
+	
+	return failures > 0 ? 1 : 0;
+}
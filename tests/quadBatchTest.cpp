@@ -0,0 +1,141 @@
+//
+// quadBatchTest.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Builds quads for a few sprites without a GL context and checks their corners, texture
+// coordinates and colors.  Exits with 1 when any value is wrong
+
+#include "ofxParticleQuadBatch.h"
+#include "ofxParticleTypes.h"
+#include <stdio.h>
+#include <math.h>
+
+#define TEST_POSITION_ERROR		1e-4f
+#define TEST_HALF_ERROR			0.125f		// Half precision within 256 pixels of the origin
+
+static int failures = 0;
+
+// ------------------------------------------------------------------------
+// Helpers
+// ------------------------------------------------------------------------
+
+static void checkFloat( const char* what, int corner, GLfloat value, GLfloat expected, GLfloat tolerance )
+{
+	if ( fabsf( value - expected ) <= tolerance )
+		return;
+	
+	printf( "%s of corner %d is %.9g, expected %.9g\n", what, corner, value, expected );
+	failures++;
+}
+
+static void checkByte( const char* what, int corner, GLubyte value, GLubyte expected )
+{
+	if ( value == expected )
+		return;
+	
+	printf( "%s of corner %d is %d, expected %d\n", what, corner, value, expected );
+	failures++;
+}
+
+// Corners go counter-clockwise from the top left, as a quad centered on x, y of size
+// size, with the texture rectangle mapped onto it the same way round
+static void checkQuad( const ParticleQuadVertex* quad, GLfloat x, GLfloat y, GLfloat size, const ParticleTexRect& rect,
+					   GLubyte red, GLubyte green, GLubyte blue, GLubyte alpha, GLfloat tolerance )
+{
+	GLfloat half = size * 0.5f;
+	GLfloat cornerX[4] = { x - half, x + half, x + half, x - half };
+	GLfloat cornerY[4] = { y - half, y - half, y + half, y + half };
+	GLfloat cornerU[4] = { rect.u0, rect.u1, rect.u1, rect.u0 };
+	GLfloat cornerV[4] = { rect.v0, rect.v0, rect.v1, rect.v1 };
+	
+	for ( int k = 0; k < 4; k++ )
+	{
+		checkFloat( "x", k, quad[k].x, cornerX[k], tolerance );
+		checkFloat( "y", k, quad[k].y, cornerY[k], tolerance );
+		checkFloat( "u", k, quad[k].u, cornerU[k], 0.0f );
+		checkFloat( "v", k, quad[k].v, cornerV[k], 0.0f );
+		checkByte( "red", k, quad[k].red, red );
+		checkByte( "green", k, quad[k].green, green );
+		checkByte( "blue", k, quad[k].blue, blue );
+		checkByte( "alpha", k, quad[k].alpha, alpha );
+	}
+}
+
+// ------------------------------------------------------------------------
+// Main
+// ------------------------------------------------------------------------
+
+int main()
+{
+	// A particle rotated 30 degrees around the source, as radial emitters place them.  Point
+	// sprites do not spin, so its quad stays axis aligned around the rotated position
+	const GLfloat sourceX = 400.0f, sourceY = 300.0f;
+	const GLfloat radius = 100.0f;
+	const GLfloat angle = DEGREES_TO_RADIANS( 30.0f );
+	
+	PointSprite sprites[2];
+	sprites[0].x = sourceX - cosf( angle ) * radius;
+	sprites[0].y = sourceY - sinf( angle ) * radius;
+	sprites[0].size = 32.0f;
+	sprites[0].color = Color4fMake( 1.0f, 0.5f, 0.25f, 0.75f );
+	
+	// Colors outside 0..1 are clamped
+	sprites[1].x = 20.0f;
+	sprites[1].y = 40.0f;
+	sprites[1].size = 5.0f;
+	sprites[1].color = Color4fMake( -0.5f, 1.5f, 0.0f, 1.0f );
+	
+	// A flipped sub-rectangle of the texture, as an atlas frame would be
+	ParticleTexRect rect;
+	rect.u0 = 0.25f;
+	rect.v0 = 1.0f;
+	rect.u1 = 0.5f;
+	rect.v1 = 0.0f;
+	
+	const GLfloat offsetX = 10.0f, offsetY = -20.0f;
+	
+	ParticleQuadVertex quads[3 * 4];
+	ofxParticleQuadBatch::buildQuads( sprites, sizeof( PointSprite ), 2, rect, offsetX, offsetY, quads );
+	checkQuad( &quads[0], sprites[0].x + offsetX, sprites[0].y + offsetY, 32.0f, rect, 255, 128, 64, 191, TEST_POSITION_ERROR );
+	checkQuad( &quads[4], 30.0f, 20.0f, 5.0f, rect, 0, 255, 0, 255, TEST_POSITION_ERROR );
+	
+	// The packed sprite holds the rotated particle relative to the source
+	PackedPointSprite packed;
+	ofxParticlePackSprite( &packed, sprites[0].x - sourceX, sprites[0].y - sourceY, 32.0f, 1.0f, 0.5f, 0.25f, 0.75f );
+	ofxParticleQuadBatch::buildQuads( &packed, 1, rect, sourceX + offsetX, sourceY + offsetY, &quads[8] );
+	checkQuad( &quads[8], sprites[0].x + offsetX, sprites[0].y + offsetY, 32.0f, rect, 255, 128, 64, 191, TEST_HALF_ERROR );
+	
+	// The batch appends after what it already holds
+	ofxParticleQuadBatch batch;
+	batch.build( sprites, sizeof( PointSprite ), 2, rect );
+	batch.append( &packed, 1, rect, sourceX, sourceY );
+	if ( batch.getQuadCount() != 3 ) {
+		printf( "batch holds %d quads, expected 3\n", batch.getQuadCount() );
+		failures++;
+	} else {
+		checkQuad( &batch.getVertices()[4], 20.0f, 40.0f, 5.0f, rect, 0, 255, 0, 255, TEST_POSITION_ERROR );
+		checkQuad( &batch.getVertices()[8], sprites[0].x, sprites[0].y, 32.0f, rect, 255, 128, 64, 191, TEST_HALF_ERROR );
+	}
+	
+	printf( "%s\n", failures == 0 ? "ok" : "FAILED" );
+	return failures > 0 ? 1 : 0;
+}
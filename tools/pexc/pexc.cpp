@@ -0,0 +1,111 @@
+//
+// pexc.cpp
+//
+// Copyright (c) 2010 71Squared, ported to Openframeworks by Shawn Roske
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+// Command line converter from Particle Designer .pex files to compiled configs.  Build it
+// with the Makefile next to this file, which compiles it against openFrameworks with the
+// addon sources it needs from src/
+//
+//	pexc [-embed] input.pex [output.pexb]
+//
+// -embed decodes the sprite image named in the config and stores its pixels in the output,
+// so the emitter needs no image file at run time.  Images embedded in the .pex itself are
+// always kept.  Without an output name the compiled
+// config is written next to the input, where the emitters pick it up automatically
+
+#include "ofMain.h"
+#include "ofxParticleEmitterConfig.h"
+#include "ofxParticleBinaryConfig.h"
+
+static int usage()
+{
+	fprintf( stderr, "usage: pexc [-embed] input.pex [output.pexb]\n" );
+	return 1;
+}
+
+int main( int argc, char** argv )
+{
+	bool embed = false;
+	std::vector<std::string> names;
+	
+	for ( int i = 1; i < argc; i++ )
+	{
+		std::string arg = argv[i];
+		if ( arg == "-embed" )
+			embed = true;
+		else if ( arg.size() > 1 && arg[0] == '-' )
+			return usage();
+		else
+			names.push_back( arg );
+	}
+	
+	if ( names.empty() || names.size() > 2 )
+		return usage();
+	
+	// Paths are taken relative to the working directory rather than a data folder
+	ofSetDataPathRoot( "" );
+	
+	std::string input = names[0];
+	std::string output = names.size() > 1 ? names[1] : ofxParticleBinaryConfig::getCompiledName( input );
+	
+	ofxParticleEmitterConfigPtr config = ofxParticleEmitterConfig::loadFromXml( input );
+	if ( config.isNull() )
+	{
+		fprintf( stderr, "pexc: unable to read %s\n", input.c_str() );
+		return 1;
+	}
+	
+	ofImage image;
+	unsigned char* pixels = NULL;
+	int channels = 0;
+	
+	if ( embed && config->texturePixels == NULL && config->textureName != "" )
+	{
+		// Sprite images are named relative to the .pex file
+		size_t slash = input.find_last_of( "/\\" );
+		std::string imagePath = slash == std::string::npos ? config->textureName : input.substr( 0, slash + 1 ) + config->textureName;
+		
+		image.setUseTexture( false );
+		if ( !image.loadImage( imagePath ) )
+		{
+			fprintf( stderr, "pexc: unable to read %s\n", imagePath.c_str() );
+			return 1;
+		}
+		
+		pixels = image.getPixels();
+		channels = image.bpp / 8;
+	}
+	else if ( embed && config->texturePixels == NULL )
+	{
+		fprintf( stderr, "pexc: %s names no image file to embed\n", input.c_str() );
+	}
+	
+	if ( !ofxParticleBinaryConfig::save( *config, output, pixels, image.width, image.height, channels ) )
+	{
+		fprintf( stderr, "pexc: unable to write %s\n", output.c_str() );
+		return 1;
+	}
+	
+	printf( "%s -> %s%s\n", input.c_str(), output.c_str(), pixels != NULL || config->texturePixels != NULL ? " (image embedded)" : "" );
+	return 0;
+}